@@ -4,14 +4,21 @@
 
 #define BOOST_TEST_MODULE seqpair_tests
 
+#include <set>
 #include <boost/test/included/unit_test.hpp>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/dag_shortest_paths.hpp>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 #include <boost/graph/graph_traits.hpp>
 #include <boost/property_map/property_map.hpp>
+#include "island_net.h"
 #include "layout.h"
+#include "netlist.h"
 #include "pack_generator.h"
+#include "portfolio.h"
+#include "random_engine.h"
+#include "sa_packer.h"
+#include "verification.h"
 
 #define SERIALIZE_GENERATOR_BASE_TESTS
 
@@ -32,6 +39,14 @@ namespace {
             return (base_t::_sp_y);
         }
 
+        decltype(auto) inv_x() {
+            return (base_t::_inv_x);
+        }
+
+        decltype(auto) inv_y() {
+            return (base_t::_inv_y);
+        }
+
         decltype(auto) widths() {
             return (base_t::_widths);
         }
@@ -40,10 +55,97 @@ namespace {
             return (base_t::_heights);
         }
 
-        template<typename... Types>
-        auto eval(Types &&...args) {
-            return base_t::_eval(std::forward<Types>(args)...);
+        // Sequence pair may have been assigned directly
+        template<typename Layout, typename Eng, typename... Types>
+        auto eval(Layout &layout, Eng &&, Types &&...args) {
+            base_t::_make_inverses();
+            return base_t::_eval(layout, layout.x_begin(), layout.y_begin(), 
+                std::forward<Types>(args)...);
+        }
+    };
+
+    // Reference DAG evaluation with Boost.Graph: adds all O(n^2) constraint 
+    // edges and runs dag_shortest_paths on negated weights.
+    template<typename Cont0, typename Cont1, typename Cont2>
+    pair<int, int> eval_sp_with_boost_graph(const Cont0 &sp_x, const Cont0 &sp_y,
+        const Cont1 &widths, const Cont1 &heights, Cont2 &x, Cont2 &y) {
+        using namespace boost;
+        using graph_t = adjacency_list<vecS, vecS, directedS,
+            property<vertex_distance_t, int>,
+            property<edge_weight_t, int>>;
+
+        const auto sz = sp_x.size();
+        vector<size_t> sx(sz), sy(sz);
+        rect_packing::detail::make_left_inverse(sp_x.cbegin(), sp_x.cend(), sx.begin());
+        rect_packing::detail::make_left_inverse(sp_y.cbegin(), sp_y.cend(), sy.begin());
+
+        const auto src = sz, target = sz + 1;
+        graph_t hg(sz + 2), vg(sz + 2);
+        for (size_t i = 0; i != sz; ++i) {
+            add_edge(src, i, 0, hg);
+            add_edge(src, i, 0, vg);
+            add_edge(i, target, -widths[i], hg);
+            add_edge(i, target, -heights[i], vg);
+        }
+        for (size_t i = 0; i != sz; ++i)
+            for (size_t j = 0; j != sz; ++j)
+                if (sy[i] < sy[j]) {
+                    if (sx[i] < sx[j])
+                        add_edge(i, j, -widths[i], hg);
+                    else
+                        add_edge(i, j, -heights[i], vg);
+                }
+
+        std::array<int, 2> sizes;
+        std::array<graph_t *, 2> graphs{ std::addressof(hg), std::addressof(vg) };
+        std::array<Cont2 *, 2> dests{ std::addressof(x), std::addressof(y) };
+        for (int k = 0; k != 2; ++k) {
+            auto &g = *graphs[k];
+            auto d_map = get(vertex_distance, g);
+            dag_shortest_paths(g, src, distance_map(d_map));
+            for (size_t i = 0; i != sz; ++i)
+                (*dests[k])[i] = -d_map[i];
+            sizes[k] = -d_map[target];
+        }
+        return { sizes[0], sizes[1] };
+    }
+
+    // Placement problem of the policy tests: 30 random components joined by
+    // 60 random two-pin nets. Its seed is fixed, and logged to reproduce a
+    // failure.
+    struct policy_problem {
+        explicit policy_problem(unsigned problem_seed = 1017) : seed(problem_seed) {
+            BOOST_TEST_MESSAGE("Policy problem seed: " << seed);
+            default_random_engine eng(seed);
+            layout = rect_packing::verification::make_random_layout(30, 1, 16, eng);
+            uniform_int_distribution<size_t> rand_cell(0, layout.size() - 1);
+            nets.resize(60);
+            for (auto &net : nets)
+                net = make_pair(rand_cell(eng), rand_cell(eng));
         }
+
+        // Packer of area plus half the wirelength, seeded by seed.
+        auto make_packer(const rect_packing::SaPackerBase::options_t &opts) const {
+            using namespace rect_packing;
+            auto packer = makeSaPacker<LcsPackGenerator<>>(opts, 
+                SaPackerBase::incremental_energy_function(0.5));
+            packer.seed(seed);
+            return packer;
+        }
+
+        // Checks that energy is the cost of packed, which has no overlaps.
+        void check(const rect_packing::Layout<> &packed, double energy) const {
+            using namespace rect_packing;
+            auto area = packed.get_area();
+            BOOST_TEST(energy == packing_cost(packed, nets.cbegin(), nets.cend(), 
+                area.first, area.second, 0.5));
+            pair<size_t, size_t> which;
+            BOOST_TEST(!verification::find_intersection(packed, which));
+        }
+
+        unsigned seed;
+        rect_packing::Layout<> layout;
+        vector<pair<size_t, size_t>> nets;
     };
 }
 
@@ -168,6 +270,134 @@ BOOST_AUTO_TEST_CASE(eval_sp2_test) {
     BOOST_TEST(ans == 10);
 }
 
+BOOST_AUTO_TEST_CASE(VebSet_test) {
+    using rect_packing::detail::VebSet;
+    constexpr size_t test_size = 5000;  // Three levels
+    default_random_engine eng(random_device{}());
+
+    vector<VebSet::word_t> words(VebSet::words_needed(test_size));
+    VebSet s(words.data(), test_size);
+    s.clear();
+    set<size_t> expected;
+    uniform_int_distribution<size_t> rand_key(0, test_size - 1);
+    for (int i = 0; i != 20000; ++i) {
+        auto k = rand_key(eng);
+        if (i % 3 == 2) {
+            s.erase(k);
+            expected.erase(k);
+        } else {
+            s.insert(k);
+            expected.insert(k);
+        }
+        auto q = rand_key(eng);
+        auto it = expected.upper_bound(q);
+        BOOST_TEST(s.successor(q) == (it == expected.end() ? VebSet::npos : *it));
+        it = expected.lower_bound(q);
+        BOOST_TEST(s.predecessor(q) == (it == expected.begin() ? VebSet::npos : *prev(it)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(random_engine_test) {
+    using namespace rect_packing;
+    using namespace rect_packing::detail;
+    Xoshiro256ss eng;
+    eng.set_state({ 1, 2, 3, 4 });  // Reference outputs of xoshiro256**
+    BOOST_TEST(eng() == 11520u);
+    BOOST_TEST(eng() == 0u);
+    BOOST_TEST(eng() == 1509978240u);
+    BOOST_TEST(eng() == 1215971899390074240u);
+    eng.seed(random_device{}());
+
+    constexpr size_t n = 7, draws = 70000;
+    vector<size_t> counts(n, 0);
+    for (size_t k = 0; k != draws; ++k) {
+        auto i = bounded_random(eng, n);
+        BOOST_REQUIRE(i < n);
+        ++counts[i];
+        size_t a, b;
+        tie(a, b) = random_distinct_pair(eng, n);
+        BOOST_TEST((a < n && b < n && a != b));
+        tie(a, b) = random_long_range(eng, n);
+        BOOST_TEST((a + 1 < b && b <= n));
+    }
+    for (auto c : counts)   // Over 6 sigmas away otherwise
+        BOOST_TEST((c > 9400 && c < 10600));
+
+    // Mean and P(x < 1) of the exponential ziggurat, and of the fallback
+    default_random_engine std_eng(random_device{}());
+    double sum = 0, std_sum = 0;
+    size_t below = 0;
+    for (size_t k = 0; k != draws; ++k) {
+        auto x = exponential_random(eng);
+        BOOST_REQUIRE(x >= 0);
+        sum += x;
+        below += x < 1;
+        std_sum += exponential_random(std_eng);
+    }
+    BOOST_TEST(abs(sum / draws - 1) < 0.03);
+    BOOST_TEST(abs(std_sum / draws - 1) < 0.03);
+    BOOST_TEST(abs(static_cast<double>(below) / draws - (1 - exp(-1.0))) < 0.015);
+}
+
+BOOST_AUTO_TEST_CASE(eval_sp2_engines_test) {
+    using namespace rect_packing::detail;
+    default_random_engine eng(random_device{}());
+
+    for (size_t test_size : { 1, 2, 63, 64, 65, 1000, 5000 }) {
+        vector<size_t> x(test_size), y(test_size), match(test_size), buffer(test_size);
+        vector<int> len(test_size);
+        iota(begin(x), end(x), 0);
+        iota(begin(y), end(y), 0);
+        shuffle(begin(x), end(x), eng);
+        shuffle(begin(y), end(y), eng);
+        uniform_int_distribution<int> rand_len(1, 16);
+        for (auto &e : len)
+            e = rand_len(eng);
+
+        vector<int> map_pos(test_size), fenwick_pos(test_size), veb_pos(test_size),
+            simd_pos(test_size);
+        vector<ptrdiff_t> tree(test_size), vals(test_size);
+        vector<VebSet::word_t> words(VebSet::words_needed(test_size));
+        vector<int32_t> tops(simd_tops_size(test_size));
+        auto map_ans = eval_sp2(begin(y), end(y), begin(x), begin(len), begin(map_pos),
+            begin(buffer), begin(match), map<ptrdiff_t, ptrdiff_t>());
+        auto fenwick_ans = eval_sp2_fenwick(begin(y), end(y), begin(x), begin(len),
+            begin(fenwick_pos), begin(buffer), begin(match), begin(tree));
+        auto veb_ans = eval_sp2_veb(begin(y), end(y), begin(x), begin(len),
+            begin(veb_pos), begin(buffer), begin(match), words.data(), begin(vals));
+        auto simd_ans = eval_sp2_simd(begin(y), end(y), begin(x), begin(len),
+            begin(simd_pos), begin(buffer), begin(match), tops.data());
+        BOOST_TEST(fenwick_ans == map_ans);
+        BOOST_TEST(veb_ans == map_ans);
+        BOOST_TEST(simd_ans == map_ans);
+        BOOST_TEST(fenwick_pos == map_pos);
+        BOOST_TEST(veb_pos == map_pos);
+        BOOST_TEST(simd_pos == map_pos);
+
+        // Fused passes against separate x and y passes
+        vector<int> heights(len.rbegin(), len.rend()), map_y_pos(test_size);
+        auto map_y_ans = eval_sp2(begin(y), end(y), x.rbegin(), begin(heights),
+            begin(map_y_pos), begin(buffer), begin(match), map<ptrdiff_t, ptrdiff_t>());
+        vector<size_t> inv_y(test_size);
+        make_left_inverse(begin(y), end(y), begin(inv_y));
+        vector<int> x_pos(test_size), y_pos(test_size);
+        vector<ptrdiff_t> y_tree(test_size);
+        vector<int32_t> y_tops(simd_tops_size(test_size));
+        auto fenwick_area = eval_sp2_xy_fenwick(begin(x), end(x), begin(inv_y),
+            begin(len), begin(heights), begin(x_pos), begin(y_pos), 
+            begin(tree), begin(y_tree));
+        BOOST_TEST((fenwick_area == make_pair(map_ans, map_y_ans)));
+        BOOST_TEST(x_pos == map_pos);
+        BOOST_TEST(y_pos == map_y_pos);
+        auto simd_area = eval_sp2_xy_simd(begin(x), end(x), begin(inv_y),
+            begin(len), begin(heights), begin(x_pos), begin(y_pos),
+            tops.data(), y_tops.data());
+        BOOST_TEST((simd_area == make_pair(map_ans, map_y_ans)));
+        BOOST_TEST(x_pos == map_pos);
+        BOOST_TEST(y_pos == map_y_pos);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(LcsGeneratorBase_test) {
     using namespace rect_packing;
     vector<pair<int, int>> components{
@@ -203,6 +433,1003 @@ BOOST_AUTO_TEST_CASE(LcsGeneratorBase_test) {
     BOOST_TEST(h == 10);
 }
 
+BOOST_AUTO_TEST_CASE(LcsGeneratorBase_engines_test) {
+    using namespace rect_packing;
+    using generator_t = DebugGenerator<detail::LcsPackGeneratorBase<>>;
+    using engine_t = typename generator_t::engine_t;
+    default_random_engine eng(random_device{}());
+    auto components = verification::make_random_layout(300, 1, 16, eng);
+
+    generator_t gen(components.widths(), components.heights(), eng);
+    Layout<> layout;    // Synchronized with rotated components
+    for (size_t i = 0; i != gen.size(); ++i)
+        layout.push(gen.widths()[i], gen.heights()[i]);
+    auto res = gen.make_resource();
+    vector<Layout<>> layouts;
+    vector<pair<int, int>> areas;
+    for (auto engine : { engine_t::map, engine_t::fenwick, engine_t::veb, 
+        engine_t::simd, engine_t::automatic }) {
+        gen.set_engine(engine);
+        layouts.push_back(layout);
+        areas.push_back(gen.eval(layouts.back(), eng, res, allocator<void>()));
+    }
+    for (size_t i = 1; i != layouts.size(); ++i) {
+        BOOST_TEST((areas[i] == areas[0]));
+        BOOST_TEST(layouts[i].x() == layouts[0].x());
+        BOOST_TEST(layouts[i].y() == layouts[0].y());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LcsGeneratorBase_incremental_test) {
+    using namespace rect_packing;
+    using generator_t = DebugGenerator<detail::LcsPackGeneratorBase<>>;
+    using engine_t = typename generator_t::engine_t;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(200, 1, 16, eng);
+
+    generator_t gen(layout.widths(), layout.heights(), eng);
+    gen.set_engine(engine_t::incremental);
+    auto res = gen.make_resource();
+    typename generator_t::default_change_distribution chg_dist;
+    bernoulli_distribution rand_rollback(0.7);
+    for (int i = 0; i != 2000; ++i) {
+        auto area = gen(layout, eng, res, chg_dist, allocator<void>());
+        // Evaluate the same state from scratch
+        generator_t ref(gen);
+        ref.set_engine(engine_t::fenwick);
+        auto ref_layout = layout;
+        auto ref_res = ref.make_resource();
+        auto ref_area = ref.eval(ref_layout, eng, ref_res, allocator<void>());
+        BOOST_TEST((area == ref_area));
+        BOOST_TEST(layout.x() == ref_layout.x());
+        BOOST_TEST(layout.y() == ref_layout.y());
+        if (rand_rollback(eng))
+            gen.rollback();
+    }
+}
+
+template<typename Index, typename Coord>
+void test_lcs_generator_types() {
+    using namespace rect_packing;
+    using generator_t = detail::LcsPackGeneratorBase<>;
+    using typed_generator_t = detail::LcsPackGeneratorBase<allocator<void>, Index, Coord>;
+    using engine_t = typename typed_generator_t::engine_t;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(200, 1, 16, eng);
+    Layout<allocator<void>, Coord> typed_layout;
+    for (size_t i = 0; i != layout.size(); ++i)
+        typed_layout.push(layout.widths()[i], layout.heights()[i]);
+
+    for (auto engine : { engine_t::map, engine_t::fenwick, engine_t::veb,
+        engine_t::incremental, engine_t::simd }) {
+        // Same engine state gives the same moves
+        auto typed_eng = eng;
+        generator_t gen(layout.widths(), layout.heights(), eng);
+        typed_generator_t typed_gen(layout.widths(), layout.heights(), typed_eng);
+        gen.set_engine(static_cast<typename generator_t::engine_t>(engine));
+        typed_gen.set_engine(engine);
+        auto res = gen.make_resource();
+        auto typed_res = typed_gen.make_resource();
+        typename generator_t::default_change_distribution chg_dist;
+        for (int i = 0; i != 200; ++i) {
+            auto area = gen(layout, eng, res, chg_dist, allocator<void>());
+            auto typed_area = typed_gen(typed_layout, typed_eng, typed_res, chg_dist,
+                allocator<void>());
+            BOOST_TEST(area.first == typed_area.first);
+            BOOST_TEST(area.second == typed_area.second);
+            BOOST_TEST(equal(layout.x().cbegin(), layout.x().cend(), 
+                typed_layout.x().cbegin()));
+            BOOST_TEST(equal(layout.y().cbegin(), layout.y().cend(),
+                typed_layout.y().cbegin()));
+            if (i % 3 == 0) {
+                gen.rollback();
+                typed_gen.rollback();
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LcsPackGeneratorBase_types_test) {
+    test_lcs_generator_types<uint16_t, int32_t>();
+    test_lcs_generator_types<uint32_t, int64_t>();
+}
+
+template<size_t N>
+void test_fixed_lcs_generator() {
+    using namespace rect_packing;
+    using generator_t = detail::LcsPackGeneratorBase<>;
+    using fixed_generator_t = detail::FixedLcsPackGeneratorBase<N>;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(N, 1, 16, eng);
+    auto fixed_layout = layout;
+
+    // Same engine state gives the same moves
+    auto fixed_eng = eng;
+    generator_t gen(layout.widths(), layout.heights(), eng);
+    fixed_generator_t fixed_gen(layout.widths(), layout.heights(), fixed_eng);
+    auto res = gen.make_resource();
+    auto fixed_res = fixed_gen.make_resource();
+    typename generator_t::default_change_distribution chg_dist;
+    default_random_engine rollback_eng(random_device{}());
+    bernoulli_distribution rand_rollback(0.5);
+    for (int i = 0; i != 1000; ++i) {
+        auto area = gen(layout, eng, res, chg_dist, allocator<void>());
+        auto fixed_area = fixed_gen(fixed_layout, fixed_eng, fixed_res, chg_dist,
+            allocator<void>());
+        BOOST_TEST((area == fixed_area));
+        BOOST_TEST(layout.x() == fixed_layout.x());
+        BOOST_TEST(layout.y() == fixed_layout.y());
+        if (rand_rollback(rollback_eng)) {
+            gen.rollback();
+            fixed_gen.rollback();
+        }
+    }
+
+    // Copies reproduce the evaluation
+    fixed_generator_t fixed_copy;
+    detail::unguarded_copy_generator(fixed_gen, fixed_copy);
+    auto copy_layout = fixed_layout;
+    auto copy_eng = fixed_eng;
+    auto area = fixed_gen(fixed_layout, fixed_eng, fixed_res, chg_dist, allocator<void>());
+    auto copy_area = fixed_copy(copy_layout, copy_eng, fixed_res, chg_dist, allocator<void>());
+    BOOST_TEST((area == copy_area));
+    BOOST_TEST(fixed_layout.x() == copy_layout.x());
+    BOOST_TEST(fixed_layout.y() == copy_layout.y());
+}
+
+BOOST_AUTO_TEST_CASE(FixedLcsPackGeneratorBase_test) {
+    test_fixed_lcs_generator<2>();
+    test_fixed_lcs_generator<32>();
+    test_fixed_lcs_generator<300>();
+}
+
+BOOST_AUTO_TEST_CASE(incremental_energy_function_test) {
+    using namespace rect_packing;
+    using generator_t = detail::LcsPackGeneratorBase<>;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(200, 1, 16, eng);
+    uniform_int_distribution<size_t> rand_cell(0, layout.size() - 1);
+    vector<pair<size_t, size_t>> nets(400);
+    for (auto &net : nets)
+        net = make_pair(rand_cell(eng), rand_cell(eng));
+
+    generator_t gen(layout.widths(), layout.heights(), eng);
+    gen.set_tracks_moved_cells(true);
+    auto res = gen.make_resource();
+    typename generator_t::default_change_distribution chg_dist;
+    SaPackerBase::incremental_energy_function func(0.5);
+    func.reset(layout, nets.cbegin(), nets.cend());
+    // follower redoes the moves kept, updating by its own moved cells
+    auto follower = gen;
+    auto follower_layout = layout;
+    auto follower_func = func;
+    bernoulli_distribution rand_rollback(0.5);
+    for (int i = 0; i != 2000; ++i) {
+        int w, h;
+        tie(w, h) = gen(layout, eng, res, chg_dist, allocator<void>());
+        const auto &cells = gen.moved_cells();
+        auto energy = func(layout, nets.cbegin(), nets.cend(), w, h, 
+            cells.cbegin(), cells.cend());
+        BOOST_TEST(energy == packing_cost(layout, nets.cbegin(), nets.cend(), w, h, 0.5));
+        if (rand_rollback(eng)) {
+            gen.rollback();
+            func.rollback();
+            continue;
+        }
+        tie(w, h) = follower.redo(gen.last_change(), follower_layout, eng, res,
+            allocator<void>());
+        const auto &follower_cells = follower.moved_cells();
+        BOOST_TEST(follower_func(follower_layout, nets.cbegin(), nets.cend(), w, h,
+            follower_cells.cbegin(), follower_cells.cend()) == energy);
+        BOOST_TEST(follower_layout.x() == layout.x());
+        BOOST_TEST(follower_layout.y() == layout.y());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TwoPinNetlist_test) {
+    using namespace rect_packing;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(1000, 1, 1000, eng);
+    uniform_int_distribution<int> rand_pos(-1000000, 1000000);
+    Layout<allocator<void>, int64_t> wide_layout;
+    for (size_t i = 0; i != layout.size(); ++i) {
+        layout.set_x(i, rand_pos(eng));
+        layout.set_y(i, rand_pos(eng));
+        wide_layout.push(layout.widths()[i], layout.heights()[i]);
+        wide_layout.set_x(i, layout.x()[i]);
+        wide_layout.set_y(i, layout.y()[i]);
+    }
+    uniform_int_distribution<size_t> rand_cell(0, layout.size() - 1);
+    vector<pair<size_t, size_t>> pairs(1003);
+    for (auto &p : pairs)
+        p = make_pair(rand_cell(eng), rand_cell(eng));
+    TwoPinNetlist nets(pairs.cbegin(), pairs.cend());
+    BOOST_TEST(nets.size() == pairs.size());
+    BOOST_TEST(equal(nets.begin(), nets.end(), pairs.cbegin()));
+
+    // The kernel equals the generic loop on any subrange
+    for (size_t first = 0; first != 10; ++first) {
+        auto last = pairs.size() - 3 * first;
+        auto len = sum_manhattan_distances(layout, pairs.cbegin() + first,
+            pairs.cbegin() + last);
+        BOOST_TEST(sum_manhattan_distances(layout, nets.begin() + first, 
+            nets.begin() + last) == len);
+        BOOST_TEST(sum_manhattan_distances(wide_layout, nets.begin() + first,
+            nets.begin() + last) == len);
+        BOOST_TEST(packing_cost(layout, nets.begin() + first, nets.begin() + last, 
+            10, 20, 0.5) == packing_cost(layout, pairs.cbegin() + first, 
+            pairs.cbegin() + last, 10, 20, 0.5));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hpwl_energy_function_test) {
+    using namespace rect_packing;
+    using generator_t = detail::LcsPackGeneratorBase<>;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(200, 1, 16, eng);
+    uniform_int_distribution<size_t> rand_cell(0, layout.size() - 1);
+    uniform_int_distribution<size_t> rand_degree(1, 8);
+    Netlist netlist;
+    vector<size_t> pins;
+    for (int k = 0; k != 100; ++k) {
+        pins.resize(rand_degree(eng));
+        for (auto &p : pins)
+            p = rand_cell(eng);
+        netlist.push(pins.cbegin(), pins.cend());
+    }
+
+    // Reads back what it prints
+    stringstream ss;
+    ss << netlist;
+    Netlist read_netlist;
+    ss >> read_netlist;
+    BOOST_TEST(read_netlist.offsets() == netlist.offsets());
+    BOOST_TEST(read_netlist.pins() == netlist.pins());
+
+    // Two-pin nets are measured as pairs
+    vector<pair<size_t, size_t>> pairs(50);
+    for (auto &p : pairs)
+        p = make_pair(rand_cell(eng), rand_cell(eng));
+    Netlist pair_netlist(pairs.cbegin(), pairs.cend());
+    BOOST_TEST(sum_half_perimeters(layout, pair_netlist.begin(), pair_netlist.end()) ==
+        sum_manhattan_distances(layout, pairs.cbegin(), pairs.cend()));
+
+    generator_t gen(layout.widths(), layout.heights(), eng);
+    gen.set_tracks_moved_cells(true);
+    auto res = gen.make_resource();
+    typename generator_t::default_change_distribution chg_dist;
+    SaPackerBase::hpwl_energy_function func(0.5);
+    func.reset(layout, netlist.begin(), netlist.end());
+    bernoulli_distribution rand_rollback(0.5);
+    for (int i = 0; i != 2000; ++i) {
+        int w, h;
+        tie(w, h) = gen(layout, eng, res, chg_dist, allocator<void>());
+        const auto &cells = gen.moved_cells();
+        auto energy = func(layout, netlist.begin(), netlist.end(), w, h,
+            cells.cbegin(), cells.cend());
+        BOOST_TEST(energy == hpwl_packing_cost(layout, netlist.begin(), netlist.end(), 
+            w, h, 0.5));
+        if (rand_rollback(eng)) {
+            gen.rollback();
+            func.rollback();
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(find_intersection_test) {
+    using namespace rect_packing;
+    default_random_engine eng(random_device{}());
+    auto overlaps = [](const Layout<> &layout, size_t i, size_t j) {
+        const auto &x = layout.x(), &y = layout.y();
+        const auto &w = layout.widths(), &h = layout.heights();
+        return x[i] < x[j] + w[j] && x[j] < x[i] + w[i] &&
+            y[i] < y[j] + h[j] && y[j] < y[i] + h[i];
+    };
+
+    // Against all pairs on dense random layouts, with zero-area components
+    uniform_int_distribution<int> rand_pos(0, 40);
+    for (int t = 0; t != 2000; ++t) {
+        auto layout = verification::make_random_layout(t % 13 + 1, 0, 8, eng);
+        for (size_t i = 0; i != layout.size(); ++i) {
+            layout.set_x(i, rand_pos(eng));
+            layout.set_y(i, rand_pos(eng));
+        }
+        bool expected = false;
+        for (size_t i = 0; i != layout.size(); ++i)
+            for (size_t j = i + 1; j != layout.size(); ++j)
+                expected = expected || overlaps(layout, i, j);
+        pair<size_t, size_t> which;
+        auto found = verification::find_intersection(layout, which);
+        BOOST_TEST(found == expected);
+        if (found)
+            BOOST_TEST(overlaps(layout, which.first, which.second));
+    }
+
+    // Components on a grid with gaps, where one is moved onto another
+    auto layout = verification::make_random_layout(20000, 1, 8, eng);
+    for (size_t i = 0; i != layout.size(); ++i) {
+        layout.set_x(i, static_cast<int>(i % 100) * 8);
+        layout.set_y(i, static_cast<int>(i / 100) * 8);
+    }
+    pair<size_t, size_t> which;
+    BOOST_TEST(!verification::find_intersection(layout, which));
+    BOOST_TEST(!verification::find_intersection(layout, which, 8));
+    uniform_int_distribution<size_t> rand_cell(0, layout.size() - 1);
+    for (int t = 0; t != 10; ++t) {
+        auto i = rand_cell(eng), j = rand_cell(eng);
+        if (i == j)
+            continue;
+        auto old_x = layout.x()[i], old_y = layout.y()[i];
+        layout.set_x(i, layout.x()[j]);
+        layout.set_y(i, layout.y()[j]);
+        BOOST_TEST(verification::find_intersection(layout, which));
+        BOOST_TEST((which == make_pair(min(i, j), max(i, j))));
+        BOOST_TEST(verification::find_intersection(layout, which, 8));
+        BOOST_TEST((which == make_pair(min(i, j), max(i, j))));
+        layout.set_x(i, old_x);
+        layout.set_y(i, old_y);
+    }
+}
+
+// Runs gen with reject_width bounds against a copy evaluating in full, and 
+// checks the moved cells it reports keep an incremental energy exact.
+template<typename Generator>
+void test_generator_reject_width(Generator gen, rect_packing::Layout<> layout,
+    default_random_engine &eng) {
+    using namespace rect_packing;
+    uniform_int_distribution<size_t> rand_cell(0, layout.size() - 1);
+    vector<pair<size_t, size_t>> nets(400);
+    for (auto &net : nets)
+        net = make_pair(rand_cell(eng), rand_cell(eng));
+
+    gen.set_tracks_moved_cells(true);
+    auto ref_gen = gen;
+    auto ref_layout = layout;
+    auto res = gen.make_resource();
+    auto ref_res = ref_gen.make_resource();
+    typename Generator::default_change_distribution chg_dist;
+    auto ref_eng = eng;
+    ref_gen(ref_layout, ref_eng, ref_res, chg_dist, allocator<void>());
+    int curr_w = gen(layout, eng, res, chg_dist, allocator<void>()).first;
+    SaPackerBase::incremental_energy_function func(0.5);
+    func.reset(layout, nets.cbegin(), nets.cend());
+    bernoulli_distribution rand_rollback(0.5);
+    size_t num_stops = 0;
+    for (int i = 0; i != 1000; ++i) {
+        int bound = uniform_int_distribution<int>(curr_w / 2, curr_w * 3 / 2 + 1)(eng);
+        // Same engine state gives the same moves
+        ref_eng = eng;
+        auto ref_area = ref_gen(ref_layout, ref_eng, ref_res, chg_dist, allocator<void>());
+        auto area = gen(layout, eng, res, chg_dist, allocator<void>(), bound);
+        if (ref_area.first >= bound) {
+            BOOST_TEST(area.first >= bound);
+            gen.rollback();
+            ref_gen.rollback();
+            ++num_stops;
+            continue;
+        }
+        BOOST_TEST((area == ref_area));
+        BOOST_TEST(layout.x() == ref_layout.x());
+        BOOST_TEST(layout.y() == ref_layout.y());
+        const auto &cells = gen.moved_cells();
+        auto energy = func(layout, nets.cbegin(), nets.cend(), area.first, area.second,
+            cells.cbegin(), cells.cend());
+        BOOST_TEST(energy == packing_cost(layout, nets.cbegin(), nets.cend(), 
+            area.first, area.second, 0.5));
+        if (rand_rollback(eng)) {
+            gen.rollback();
+            ref_gen.rollback();
+            func.rollback();
+        } else {
+            curr_w = area.first;
+        }
+    }
+    BOOST_TEST(num_stops > 0u);
+    BOOST_TEST(num_stops < 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(reject_width_test) {
+    using namespace rect_packing;
+    using generator_t = detail::LcsPackGeneratorBase<>;
+    using engine_t = typename generator_t::engine_t;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(200, 1, 16, eng);
+
+    for (auto engine : { engine_t::map, engine_t::fenwick, engine_t::veb,
+        engine_t::incremental, engine_t::simd }) {
+        generator_t gen(layout.widths(), layout.heights(), eng);
+        gen.set_engine(engine);
+        test_generator_reject_width(gen, layout, eng);
+    }
+    test_generator_reject_width(detail::DagPackGeneratorBase<>(layout.widths(), 
+        layout.heights(), eng), layout, eng);
+    test_generator_reject_width(detail::FixedLcsPackGeneratorBase<200>(layout.widths(),
+        layout.heights(), eng), layout, eng);
+}
+
+// Runs moves and rollbacks on gen, and checks that the sizes it patches in
+// the layout are those of its state.
+template<typename Generator>
+void test_layout_size_sync(Generator gen, default_random_engine &eng) {
+    using namespace rect_packing;
+    using change_t = typename Generator::change_t;
+    auto layout = rect_packing::Layout<>();
+    for (size_t i = 0; i != gen.size(); ++i)
+        layout.push(1, 1);
+    auto other_layout = layout, ref_layout = layout;
+    auto res = gen.make_resource();
+    auto chg_dist = Generator::default_change_distribution::from_map({
+        make_pair(change_t::rotate, 1.0), make_pair(change_t::swap_xy, 1.0) });
+    bernoulli_distribution rand_bool(0.5);
+    for (int i = 0; i != 2000; ++i) {
+        // Alternate layouts now and then
+        auto &my_layout = i % 100 < 50 ? layout : other_layout;
+        auto area = gen(my_layout, eng, res, chg_dist, allocator<void>());
+        auto ref = gen;
+        auto ref_area = ref.pack(ref_layout, eng, res, allocator<void>());
+        BOOST_TEST((area == ref_area));
+        BOOST_TEST(my_layout.widths() == ref_layout.widths());
+        BOOST_TEST(my_layout.heights() == ref_layout.heights());
+        if (rand_bool(eng))
+            gen.rollback();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LayoutSizeSync_test) {
+    using namespace rect_packing;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(50, 1, 16, eng);
+    test_layout_size_sync(detail::LcsPackGeneratorBase<>(layout.widths(),
+        layout.heights(), eng), eng);
+    test_layout_size_sync(detail::DagPackGeneratorBase<>(layout.widths(),
+        layout.heights(), eng), eng);
+    test_layout_size_sync(detail::FixedLcsPackGeneratorBase<50>(layout.widths(),
+        layout.heights(), eng), eng);
+}
+
+// Runs moves on gen, and checks BestStateTracker against full copies of the
+// states marked as the best.
+template<typename Generator>
+void test_best_state_tracker(Generator gen, default_random_engine &eng) {
+    using namespace rect_packing;
+    auto layout = rect_packing::Layout<>();
+    for (size_t i = 0; i != gen.size(); ++i)
+        layout.push(1, 1);
+    auto best_layout = layout, ref_layout = layout;
+    auto res = gen.make_resource();
+    typename Generator::default_change_distribution chg_dist;
+    detail::BestStateTracker<Generator> best;
+    best.reset(gen);
+    auto ref = gen;
+    bernoulli_distribution rand_accept(0.5), rand_mark(0.1), rand_shuffle(0.002);
+    for (int i = 0; i != 3000; ++i) {
+        if (rand_shuffle(eng)) {
+            gen.shuffle(eng);
+            best.assign(gen);
+            detail::unguarded_copy_generator(gen, ref);
+            continue;
+        }
+        gen(layout, eng, res, chg_dist, allocator<void>());
+        if (!rand_accept(eng)) {
+            gen.rollback();
+            continue;
+        }
+        best.push(gen);
+        if (rand_mark(eng)) {
+            best.mark(gen);
+            detail::unguarded_copy_generator(gen, ref);
+        }
+        if (i % 500 == 0) {
+            auto tracked = best.best();
+            auto area = tracked.pack(best_layout, eng, res, allocator<void>());
+            auto ref_area = ref.pack(ref_layout, eng, res, allocator<void>());
+            BOOST_TEST((area == ref_area));
+            BOOST_TEST(best_layout.x() == ref_layout.x());
+            BOOST_TEST(best_layout.y() == ref_layout.y());
+        }
+    }
+    best.restore(gen);
+    auto area = gen.pack(layout, eng, res, allocator<void>());
+    auto ref_area = ref.pack(ref_layout, eng, res, allocator<void>());
+    BOOST_TEST((area == ref_area));
+    BOOST_TEST(layout.x() == ref_layout.x());
+    BOOST_TEST(layout.y() == ref_layout.y());
+    BOOST_TEST(layout.widths() == ref_layout.widths());
+}
+
+BOOST_AUTO_TEST_CASE(BestStateTracker_test) {
+    using namespace rect_packing;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(100, 1, 16, eng);
+    using generator_t = detail::LcsPackGeneratorBase<>;
+    generator_t gen(layout.widths(), layout.heights(), eng);
+    gen.set_engine(generator_t::engine_t::incremental);
+    test_best_state_tracker(gen, eng);
+    test_best_state_tracker(detail::DagPackGeneratorBase<>(layout.widths(),
+        layout.heights(), eng), eng);
+    test_best_state_tracker(detail::FixedLcsPackGeneratorBase<100>(layout.widths(),
+        layout.heights(), eng), eng);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_outline_energy_function_test) {
+    using namespace rect_packing;
+    using base_function_t = SaPackerBase::default_energy_function;
+    using func_t = SaPackerBase::fixed_outline_energy_function<base_function_t>;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(30, 1, 16, eng);
+    vector<pair<size_t, size_t>> nets;
+    auto sum_areas = layout.sum_conponent_areas();
+    auto side = ceil(sqrt(1.5 * sum_areas));
+    func_t func(base_function_t(0.8), side, side);
+
+    BOOST_TEST(func.is_feasible(int(side), int(side)));
+    BOOST_TEST(!func.is_feasible(int(side) + 1, int(side)));
+    BOOST_TEST(func.violation(int(side), int(side) - 1) == 0.0);
+    BOOST_TEST(func.violation(int(side) + 2, int(side) + 1) == 
+        func.penalty * (2 * side + side));
+
+    // No packing at least reject_width wide has a lower energy
+    uniform_real_distribution<> rand_energy(0, 4 * sum_areas);
+    uniform_int_distribution<int> rand_len(1, 4 * int(side));
+    for (int i = 0; i != 1000; ++i) {
+        auto max_energy = rand_energy(eng);
+        auto w = max(int(ceil(func.reject_width(max_energy, 16))), 0);
+        int h = 16 + rand_len(eng);
+        BOOST_TEST(func(layout, nets.cbegin(), nets.cend(), w, h) >= max_energy);
+    }
+
+    // Finds a packing in the outline
+    SaPackerBase::options_t opts;
+    opts.simulaions_per_temperature = 256;
+    auto packer = makeSaPacker<LcsPackGenerator<>>(opts, func);
+    auto energy = packer(layout, nets.cbegin(), nets.cend(), 
+        PackGeneratorBase::default_change_distribution(), allocator<void>(), 0);
+    auto area = layout.get_area();
+    BOOST_TEST(func.is_feasible(area.first, area.second));
+    BOOST_TEST(energy == func(layout, nets.cbegin(), nets.cend(), area.first, area.second));
+    BOOST_TEST((packer.first_feasible_time() != chrono::steady_clock::duration::max()));
+}
+
+BOOST_AUTO_TEST_CASE(parallel_policy_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    SaPackerBase::options_t opts;
+    opts.decreasing_ratio = 0.9;
+    opts.restart_ratio = 1.05;  // Restart often from the reduced best
+    auto packer = problem.make_packer(opts);
+    auto energy = packer(packer.par, problem.layout, problem.nets.cbegin(), 
+        problem.nets.cend(), PackGeneratorBase::default_change_distribution(), 
+        allocator<void>(), 0, 4);
+    problem.check(problem.layout, energy);
+
+    // Workers restarted from the global best, and Boltzmann resampling bred
+    // no children
+    auto &stats = packer.statistics();
+    BOOST_TEST(stats.num_restarts > 0);
+    BOOST_TEST(stats.num_generations == 0);
+    BOOST_TEST(stats.num_offspring == 0);
+}
+
+BOOST_AUTO_TEST_CASE(tempering_policy_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    SaPackerBase::options_t opts;
+    opts.simulaions_per_temperature = 256;
+    opts.decreasing_ratio = 0.9;
+    auto packer = problem.make_packer(opts);
+    auto energy = packer(packer.temper, problem.layout, problem.nets.cbegin(), 
+        problem.nets.cend(), PackGeneratorBase::adaptive_change_distribution(), 
+        allocator<void>(), 0, 3);
+    problem.check(problem.layout, energy);
+
+    // Neighbouring rungs swapped replicas
+    auto &stats = packer.statistics();
+    BOOST_TEST(stats.num_exchange_trials > 0);
+    BOOST_TEST(stats.num_exchanges > 0);
+    BOOST_TEST(stats.num_exchanges <= stats.num_exchange_trials);
+}
+
+BOOST_AUTO_TEST_CASE(tempering_policy_replicas_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    SaPackerBase::options_t opts;
+    opts.simulaions_per_temperature = 256;
+    opts.decreasing_ratio = 0.9;
+    auto packer = problem.make_packer(opts);
+    auto seq_layout = problem.layout;
+    auto seq_energy = packer(seq_layout, problem.nets.cbegin(), problem.nets.cend(),
+        PackGeneratorBase::default_change_distribution(), allocator<void>(), 0);
+
+    // Every replica runs a full temperature per round, so more replicas do 
+    // not end hotter or worse than one chain
+    constexpr unsigned num_replicas = 8;
+    auto energy = packer(packer.temper, problem.layout, problem.nets.cbegin(), 
+        problem.nets.cend(), PackGeneratorBase::default_change_distribution(), 
+        allocator<void>(), 0, num_replicas);
+    problem.check(problem.layout, energy);
+    BOOST_TEST(energy <= seq_energy);
+}
+
+BOOST_AUTO_TEST_CASE(speculative_policy_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    SaPackerBase::options_t opts;
+    opts.simulaions_per_temperature = 250;  // Not a multiple of the threads
+    opts.decreasing_ratio = 0.9;
+    auto packer = problem.make_packer(opts);
+    auto energy = packer(packer.spec, problem.layout, problem.nets.cbegin(), 
+        problem.nets.cend(), PackGeneratorBase::adaptive_change_distribution(), 
+        allocator<void>(), 0, 3);
+    problem.check(problem.layout, energy);
+
+    // Annealing went speculative
+    BOOST_TEST(packer.statistics().num_batches > 0);
+}
+
+BOOST_AUTO_TEST_CASE(SingleSlotMailbox_test) {
+    using namespace rect_packing;
+    detail::SingleSlotMailbox<int> box(0);
+    BOOST_TEST(!box.take());
+    box.write_slot() = 1;
+    box.post();
+    box.write_slot() = 2;
+    box.post();
+    BOOST_TEST(box.take());
+    BOOST_TEST(box.read_slot() == 2);   // Only the latest post
+    BOOST_TEST(!box.take());
+
+    // A concurrent reader only takes whole posts, and in order
+    constexpr size_t num_posts = 100000;
+    detail::SingleSlotMailbox<pair<size_t, size_t>> pairs;
+    thread writer([&] {
+        for (size_t k = 1; k <= num_posts; ++k) {
+            pairs.write_slot() = make_pair(k, 2 * k);
+            pairs.post();
+        }
+    });
+    for (size_t last = 0; last != num_posts; ) {
+        if (!pairs.take()) {
+            this_thread::yield();
+            continue;
+        }
+        auto post = pairs.read_slot();
+        BOOST_REQUIRE(post.second == 2 * post.first);
+        BOOST_REQUIRE(post.first > last);
+        last = post.first;
+    }
+    writer.join();
+    BOOST_TEST(!pairs.take());
+}
+
+BOOST_AUTO_TEST_CASE(island_policy_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    SaPackerBase::options_t opts;
+    opts.decreasing_ratio = 0.9;
+    auto packer = problem.make_packer(opts);
+    auto energy = packer(packer.island, problem.layout, problem.nets.cbegin(), 
+        problem.nets.cend(), PackGeneratorBase::adaptive_change_distribution(), 
+        allocator<void>(), 0, 3);
+    problem.check(problem.layout, energy);
+
+    // Islands migrated their bests, and each post is adopted at most once
+    auto &stats = packer.statistics();
+    BOOST_TEST(stats.num_posts > 0);
+    BOOST_TEST(stats.num_adoptions > 0);
+    BOOST_TEST(stats.num_adoptions <= stats.num_posts);
+}
+
+BOOST_AUTO_TEST_CASE(crossover_test) {
+    using namespace rect_packing;
+    using generator_t = DebugGenerator<detail::LcsPackGeneratorBase<>>;
+    using crossover_t = generator_t::crossover_t;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(40, 1, 16, eng);
+    generator_t lhs(layout.widths(), layout.heights(), eng);
+    generator_t rhs(layout.widths(), layout.heights(), eng);
+    auto res = lhs.make_resource();
+
+    for (auto kind : { crossover_t::pmx, crossover_t::order, crossover_t::cycle }) {
+        for (int t = 0; t != 20; ++t) {
+            auto child = lhs;
+            child.crossover(lhs, rhs, kind, eng);
+            for (auto sp : { &generator_t::sp_x, &generator_t::sp_y }) {
+                auto seq = (child.*sp)();
+                sort(seq.begin(), seq.end());
+                for (size_t k = 0; k != seq.size(); ++k)
+                    BOOST_REQUIRE(seq[k] == k);
+            }
+            for (size_t k = 0; k != child.size(); ++k) {
+                BOOST_TEST(child.inv_x()[child.sp_x()[k]] == k);
+                BOOST_TEST(child.inv_y()[child.sp_y()[k]] == k);
+                if (kind == crossover_t::cycle)
+                    BOOST_TEST((child.sp_x()[k] == lhs.sp_x()[k] || 
+                        child.sp_x()[k] == rhs.sp_x()[k]));
+                // Orientations are inherited
+                auto size = make_pair(child.widths()[k], child.heights()[k]);
+                BOOST_TEST((size == make_pair(lhs.widths()[k], lhs.heights()[k]) ||
+                    size == make_pair(rhs.widths()[k], rhs.heights()[k])));
+            }
+            child.pack(layout, eng, res, allocator<void>());
+            pair<size_t, size_t> which;
+            BOOST_TEST(!verification::find_intersection(layout, which));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(genetic_population_update_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    SaPackerBase::options_t opts;
+    opts.decreasing_ratio = 0.9;
+    auto packer = problem.make_packer(opts);
+    constexpr size_t num_generations = 2, num_workers = 2;
+    auto energy = packer(packer.par, problem.layout, problem.nets.cbegin(), 
+        problem.nets.cend(), PackGeneratorBase::default_change_distribution(), 
+        allocator<void>(), 0, num_workers + 1, SaPackerBase::genetic_population_update(
+            PackGeneratorBase::crossover_t::order, num_generations));
+    problem.check(problem.layout, energy);
+
+    // Each temperature but the last is followed by its generations, in which
+    // every worker breeds at most one child
+    auto &stats = packer.statistics();
+    BOOST_TEST(stats.num_generations > 0);
+    BOOST_TEST(stats.num_generations % num_generations == 0);
+    BOOST_TEST(stats.num_offspring > 0);
+    BOOST_TEST(stats.num_offspring <= stats.num_generations * num_workers);
+}
+
+BOOST_AUTO_TEST_CASE(Portfolio_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    using portfolio_t = Portfolio<allocator<void>, int>;
+    using progress_t = portfolio_t::progress_t;
+
+    // A laggard is cancelled once the leader is far ahead
+    portfolio_t::options_t popts;
+    popts.checkpoint = 10;
+    portfolio_t scripted(popts);
+    scripted.add("leader", [](portfolio_t::layout_t &, progress_t &progress) {
+        progress.min_energy = 1;
+        progress.num_temperatures = 100;
+        return 1.0;
+    });
+    scripted.add("laggard", [](portfolio_t::layout_t &, progress_t &progress) {
+        for (int t = 0; t != 10000 && !progress.cancelled; ++t) {
+            progress.min_energy = 10;
+            ++progress.num_temperatures;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        return 10.0;
+    });
+    auto scripted_layout = problem.layout;
+    BOOST_TEST(scripted(scripted_layout, 0) == 1.0);
+    BOOST_TEST(!scripted.results()[0].cancelled);
+    BOOST_TEST(scripted.results()[1].cancelled);
+
+    // A cancelled packer stops with its best after a temperature
+    SaPackerBase::options_t opts;
+    opts.decreasing_ratio = 0.9;
+    auto packer = problem.make_packer(opts);
+    progress_t progress;
+    progress.cancelled = true;
+    packer.set_progress(std::addressof(progress));
+    auto cancelled_layout = problem.layout;
+    auto energy = packer(cancelled_layout, problem.nets.cbegin(), problem.nets.cend(),
+        PackGeneratorBase::default_change_distribution(), allocator<void>(), 0);
+    BOOST_TEST(progress.num_temperatures == 1);
+    BOOST_TEST(progress.min_energy == energy);
+    problem.check(cancelled_layout, energy);
+    packer.set_progress(nullptr);
+
+    // Packers of different schedules and change distributions
+    portfolio_t portfolio;
+    PackGeneratorBase::default_change_distribution chg_dist;
+    portfolio.add("default", packer, problem.nets.cbegin(), problem.nets.cend(), chg_dist);
+    opts.decreasing_ratio = 0.8;
+    packer.set_options(opts);
+    packer.seed(problem.seed + 1);
+    portfolio.add("adaptive", packer, problem.nets.cbegin(), problem.nets.cend(),
+        PackGeneratorBase::adaptive_change_distribution(chg_dist));
+    energy = portfolio(problem.layout, 0);
+    BOOST_TEST(portfolio.results().size() == 2);
+    for (auto &r : portfolio.results()) {
+        BOOST_TEST(r.energy >= energy);
+        BOOST_TEST(r.num_temperatures > 0);     // Each reported its progress
+    }
+    problem.check(problem.layout, energy);
+}
+
+BOOST_AUTO_TEST_CASE(distributed_island_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    auto &layout = problem.layout;
+    auto &nets = problem.nets;
+    const auto widths = layout.widths();
+
+    // Two workers exchange through a coordinator on localhost
+    constexpr size_t num_workers = 2;
+    net::IslandCoordinator coordinator(0, num_workers, layout.size());
+    bool received = false;
+    thread hub([&] { received = coordinator.run(0); });
+    vector<double> energies(num_workers);
+    vector<size_t> migrations(num_workers);
+    vector<char> connected(num_workers);
+    vector<thread> workers;
+    for (size_t i = 0; i != num_workers; ++i) {
+        workers.emplace_back([&, i] {
+            SaPackerBase::options_t opts;
+            opts.decreasing_ratio = 0.9;
+            auto packer = problem.make_packer(opts);
+            packer.seed(problem.seed + i + 1);
+            net::IslandWorker worker("127.0.0.1", coordinator.port(), layout.size());
+            packer.set_migration(worker.migration(2));
+            auto my_layout = layout;
+            energies[i] = packer(my_layout, nets.cbegin(), nets.cend(),
+                PackGeneratorBase::default_change_distribution(), std::allocator<void>(), 0);
+            migrations[i] = packer.statistics().num_migrations;
+            connected[i] = worker.connected();
+            net::snapshot_t snap;
+            packer.generator().save(snap, widths);
+            worker.finish(snap, energies[i]);
+        });
+    }
+    for (auto &&t : workers)
+        t.join();
+    hub.join();
+    BOOST_TEST(received);
+    BOOST_TEST(count(connected.cbegin(), connected.cend(), 1) == num_workers);
+    BOOST_TEST(coordinator.best_energy() == *min_element(energies.cbegin(), energies.cend()));
+
+    // Workers migrated in some of the global bests sent to them
+    auto num_migrations = accumulate(migrations.cbegin(), migrations.cend(), size_t(0));
+    BOOST_TEST(coordinator.num_offers() > 0);
+    BOOST_TEST(num_migrations > 0);
+    BOOST_TEST(num_migrations <= coordinator.num_sent());
+
+    // The global best packs to its energy
+    LcsPackGenerator<> gen;
+    Xoshiro256ss xeng;
+    gen.construct(layout.widths(), layout.heights(), xeng);
+    gen.load(coordinator.best(), layout.widths(), layout.heights());
+    gen.pack(layout, xeng, std::allocator<void>());
+    problem.check(layout, coordinator.best_energy());
+}
+
+BOOST_AUTO_TEST_CASE(distributed_island_timeout_test) {
+    using namespace rect_packing;
+    policy_problem problem;
+    auto &layout = problem.layout;
+
+    // Only one of two workers shows up before the accept timeout
+    net::IslandCoordinator coordinator(0, 2, layout.size(), chrono::milliseconds(200));
+    bool received = false;
+    thread hub([&] { received = coordinator.run(0); });
+    {
+        LcsPackGenerator<> gen;
+        Xoshiro256ss xeng;
+        gen.construct(layout.widths(), layout.heights(), xeng);
+        net::snapshot_t snap;
+        gen.save(snap, layout.widths());
+        net::IslandWorker worker("127.0.0.1", coordinator.port(), layout.size());
+        worker.finish(snap, 1);
+    }
+    hub.join();
+    BOOST_TEST(received);
+    BOOST_TEST(coordinator.num_connected() == 1);
+    BOOST_TEST(coordinator.best_energy() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(adaptive_change_distribution_test) {
+    using rect_packing::PackGeneratorBase;
+    using change_t = PackGeneratorBase::change_t;
+    PackGeneratorBase::default_change_distribution prior;
+    PackGeneratorBase::adaptive_change_distribution dist(prior);
+    auto prior_probs = prior.probabilities();
+    auto probs = dist.probabilities();
+    for (size_t k = 0; k != probs.size(); ++k)
+        BOOST_TEST(abs(probs[k] - prior_probs[k]) < 1e-12);
+
+    // Only reverse_x pays off
+    default_random_engine eng(random_device{}());
+    for (int t = 0; t != 20; ++t) {
+        for (int i = 0; i != 1000; ++i) {
+            auto chg = dist(eng);
+            BOOST_REQUIRE(prior_probs[static_cast<size_t>(chg)] > 1e-9);
+            dist.update(chg, chg == change_t::reverse_x, 1.0);
+        }
+        dist.end_temperature();
+    }
+    probs = dist.probabilities();
+    BOOST_TEST(abs(accumulate(probs.cbegin(), probs.cend(), 0.0) - 1) < 1e-9);
+    BOOST_TEST(probs[static_cast<size_t>(change_t::reverse_x)] > 0.8);
+    BOOST_TEST(probs[static_cast<size_t>(change_t::swap_x)] < 1e-9);
+    auto floor = dist.min_share / 7;   // Seven changes are enabled
+    for (auto chg : { change_t::rotate, change_t::reverse_y, change_t::rotate_xy })
+        BOOST_TEST(probs[static_cast<size_t>(chg)] > 0.9 * floor);
+}
+
+BOOST_AUTO_TEST_CASE(DagPackGeneratorBase_inverse_test) {
+    using namespace rect_packing;
+    using generator_t = DebugGenerator<detail::LcsPackGeneratorBase<>>;
+    default_random_engine eng(random_device{}());
+    auto layout = verification::make_random_layout(100, 1, 16, eng);
+
+    generator_t gen(layout.widths(), layout.heights(), eng);
+    auto res = gen.make_resource();
+    typename generator_t::default_change_distribution chg_dist;
+    bernoulli_distribution rand_rollback(0.5);
+    for (int i = 0; i != 2000; ++i) {
+        gen(layout, eng, res, chg_dist, allocator<void>());
+        if (rand_rollback(eng))
+            gen.rollback();
+        for (size_t k = 0; k != gen.size(); ++k) {
+            BOOST_TEST(gen.inv_x()[gen.sp_x()[k]] == k);
+            BOOST_TEST(gen.inv_y()[gen.sp_y()[k]] == k);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(DagPackGeneratorBase_boost_graph_test) {
+    using namespace rect_packing;
+    using generator_t = DebugGenerator<detail::DagPackGeneratorBase<>>;
+    default_random_engine eng(random_device{}());
+
+    for (size_t test_size : { 1, 2, 3, 10, 100, 300 }) {
+        auto components = verification::make_random_layout(test_size, 1, 16, eng);
+        generator_t gen(components.widths(), components.heights(), eng);
+        Layout<> layout;
+        for (size_t i = 0; i != gen.size(); ++i)
+            layout.push(gen.widths()[i], gen.heights()[i]);
+        auto res = gen.make_resource(); 
+        auto area = gen.eval(layout, eng, res);
+
+        auto x = layout.x(), y = layout.y();
+        auto expected_area = eval_sp_with_boost_graph(gen.sp_x(), gen.sp_y(),
+            gen.widths(), gen.heights(), x, y);
+        BOOST_TEST((area == expected_area));
+        BOOST_TEST(layout.x() == x);
+        BOOST_TEST(layout.y() == y);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(make_reduced_constraint_graph_test) {
+    using namespace rect_packing::detail;
+    constexpr size_t test_size = 200;
+    default_random_engine eng(random_device{}());
+
+    vector<size_t> x(test_size), y(test_size), sx(test_size), sy(test_size);
+    iota(begin(x), end(x), 0);
+    iota(begin(y), end(y), 0);
+    shuffle(begin(x), end(x), eng);
+    shuffle(begin(y), end(y), eng);
+    make_left_inverse(begin(x), end(x), begin(sx));
+    make_left_inverse(begin(y), end(y), begin(sy));
+
+    for (bool below : { false, true }) {
+        auto precedes = [&](size_t i, size_t j) {
+            return sy[i] < sy[j] && (below ? sx[i] > sx[j] : sx[i] < sx[j]);
+        };
+        vector<size_t> offsets(test_size + 1), adj(test_size * test_size);
+        auto m = make_reduced_constraint_graph(begin(x), begin(sx), begin(sy),
+            test_size, below, begin(offsets), begin(adj), adj.size());
+        BOOST_TEST(m == offsets[test_size]);
+        // Edges are exactly the constraints without any component between
+        set<pair<size_t, size_t>> edges;
+        for (size_t i = 0; i != test_size; ++i)
+            for (auto k = offsets[i]; k != offsets[i + 1]; ++k)
+                edges.emplace(i, adj[k]);
+        for (size_t i = 0; i != test_size; ++i)
+            for (size_t j = 0; j != test_size; ++j) {
+                bool direct = precedes(i, j);
+                for (size_t k = 0; direct && k != test_size; ++k)
+                    if (precedes(i, k) && precedes(k, j))
+                        direct = false;
+                BOOST_TEST(direct == (edges.count(make_pair(i, j)) != 0));
+            }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(DagPackGeneratorBase_test) {
     using namespace rect_packing;
     vector<pair<int, int>> components{
@@ -238,4 +1465,4 @@ BOOST_AUTO_TEST_CASE(DagPackGeneratorBase_test) {
     BOOST_TEST(h == 10);
 }
 
-BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,394 @@
+// island_net.h: classes IslandCoordinator and IslandWorker exchanging
+//      annealing states between processes over TCP.
+// Author: LYL (Aureliano Lee)
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include "pack_generator.h"
+#include "sa_packer.h"
+
+namespace rect_packing {
+    namespace net {
+        using snapshot_t = SaPackerBase::migration_t::snapshot_t;
+
+        // Messages of a connection. A worker offers its best and gets a
+        // reply, which holds the global best if that is better, or no state
+        // otherwise. It sends done with its final best before closing.
+        enum class message_kind : std::uint8_t {
+            offer = 1, reply = 2, done = 3
+        };
+
+        // Wire format, little-endian: u32 magic, u8 kind, u32 n, f64 energy,
+        // then n u32 of sp_x, n u32 of sp_y and (n + 7) / 8 bytes of rotated
+        // bits. n is the number of components, or 0 for a reply of no state.
+        struct message_t {
+            message_kind kind = message_kind::offer;
+            double energy = 0;
+            snapshot_t snap;
+        };
+
+        namespace detail {
+            constexpr std::uint32_t magic = 0x31515053;   // "SPQ1"
+            constexpr std::size_t header_size = 4 + 1 + 4 + 8;
+
+            inline void put_u32(std::vector<std::uint8_t> &buf, std::uint32_t v) {
+                for (int i = 0; i != 4; ++i)
+                    buf.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+            }
+
+            inline std::uint32_t get_u32(const std::uint8_t *p) noexcept {
+                std::uint32_t v = 0;
+                for (int i = 0; i != 4; ++i)
+                    v |= static_cast<std::uint32_t>(p[i]) << (8 * i);
+                return v;
+            }
+
+            inline void put_f64(std::vector<std::uint8_t> &buf, double d) {
+                std::uint64_t v;
+                std::memcpy(&v, &d, sizeof(v));
+                for (int i = 0; i != 8; ++i)
+                    buf.push_back(static_cast<std::uint8_t>(v >> (8 * i)));
+            }
+
+            inline double get_f64(const std::uint8_t *p) noexcept {
+                std::uint64_t v = 0;
+                for (int i = 0; i != 8; ++i)
+                    v |= static_cast<std::uint64_t>(p[i]) << (8 * i);
+                double d;
+                std::memcpy(&d, &v, sizeof(d));
+                return d;
+            }
+
+            inline std::size_t payload_size(std::size_t n) noexcept {
+                return 8 * n + (n + 7) / 8;
+            }
+
+            // Whether seq is a permutation of [0, n).
+            inline bool is_permutation(const std::vector<std::uint32_t> &seq,
+                std::vector<bool> &seen) {
+                seen.assign(seq.size(), false);
+                for (auto v : seq) {
+                    if (v >= seq.size() || seen[v])
+                        return false;
+                    seen[v] = true;
+                }
+                return true;
+            }
+        }
+
+        // Serializes msg to buf.
+        inline void encode(const message_t &msg, std::vector<std::uint8_t> &buf) {
+            auto n = msg.snap.sp_x.size();
+            buf.clear();
+            buf.reserve(detail::header_size + detail::payload_size(n));
+            detail::put_u32(buf, detail::magic);
+            buf.push_back(static_cast<std::uint8_t>(msg.kind));
+            detail::put_u32(buf, static_cast<std::uint32_t>(n));
+            detail::put_f64(buf, msg.energy);
+            for (auto v : msg.snap.sp_x)
+                detail::put_u32(buf, v);
+            for (auto v : msg.snap.sp_y)
+                detail::put_u32(buf, v);
+            for (std::size_t i = 0; i < n; i += 8) {
+                std::uint8_t bits = 0;
+                for (std::size_t j = i; j != n && j != i + 8; ++j)
+                    bits |= static_cast<std::uint8_t>((msg.snap.rotated[j] != 0) << (j - i));
+                buf.push_back(bits);
+            }
+        }
+
+        template<typename Socket>
+        void write_message(Socket &socket, const message_t &msg,
+            std::vector<std::uint8_t> &buf) {
+            encode(msg, buf);
+            boost::asio::write(socket, boost::asio::buffer(buf));
+        }
+
+        // Reads a message of n components, or of none if it is a reply.
+        // Throws: std::runtime_error if the message is malformed
+        template<typename Socket>
+        void read_message(Socket &socket, std::size_t n, message_t &msg,
+            std::vector<std::uint8_t> &buf) {
+            using namespace std;
+            buf.resize(detail::header_size);
+            boost::asio::read(socket, boost::asio::buffer(buf));
+            auto kind = buf[4];
+            auto size = detail::get_u32(&buf[5]);
+            if (detail::get_u32(&buf[0]) != detail::magic ||
+                kind < static_cast<uint8_t>(message_kind::offer) ||
+                kind > static_cast<uint8_t>(message_kind::done))
+                throw runtime_error("island_net: bad message header");
+            msg.kind = static_cast<message_kind>(kind);
+            msg.energy = detail::get_f64(&buf[9]);
+            if (size != n && !(size == 0 && msg.kind == message_kind::reply))
+                throw runtime_error("island_net: message of " + to_string(size) +
+                    " components, expecting " + to_string(n));
+
+            buf.resize(detail::payload_size(size));
+            boost::asio::read(socket, boost::asio::buffer(buf));
+            msg.snap.sp_x.resize(size);
+            msg.snap.sp_y.resize(size);
+            msg.snap.rotated.resize(size);
+            const auto *p = buf.data();
+            for (auto &v : msg.snap.sp_x)
+                v = detail::get_u32(p), p += 4;
+            for (auto &v : msg.snap.sp_y)
+                v = detail::get_u32(p), p += 4;
+            for (size_t j = 0; j != size; ++j)
+                msg.snap.rotated[j] = (p[j / 8] >> (j % 8)) & 1;
+            vector<bool> seen;
+            if (!detail::is_permutation(msg.snap.sp_x, seen) ||
+                !detail::is_permutation(msg.snap.sp_y, seen))
+                throw runtime_error("island_net: sequence pair is not a permutation");
+        }
+
+        // Hub of the islands. Keeps the global best of n components offered
+        // by its workers, and replies to an offer with the global best if
+        // that beats it.
+        class IslandCoordinator {
+        public:
+            using tcp = boost::asio::ip::tcp;
+
+            // Listens on port, or on an ephemeral one if it is 0. Workers 
+            // that have not connected within accept_timeout of run are missing.
+            IslandCoordinator(unsigned short port, std::size_t num_workers, std::size_t n,
+                std::chrono::milliseconds accept_timeout = std::chrono::seconds(60)) :
+                _acceptor(_io, tcp::endpoint(tcp::v4(), port)),
+                _num_workers(num_workers), _n(n), _accept_timeout(accept_timeout) { }
+
+            unsigned short port() const {
+                return _acceptor.local_endpoint().port();
+            }
+
+            // Serves the connections of up to num_workers workers, accepted 
+            // till accept_timeout, till each sends done or drops.
+            // Returns: whether any state was received
+            bool run(unsigned verbose_level = 1) {
+                using namespace std;
+                vector<thread> thrds;
+                thrds.reserve(_num_workers);
+                const auto deadline = chrono::steady_clock::now() + _accept_timeout;
+                _num_connected = 0;
+                for (size_t i = 0; i != _num_workers; ++i) {
+                    auto socket = make_shared<tcp::socket>(_io);
+                    if (!_accept(*socket, deadline))
+                        break;
+                    ++_num_connected;
+                    if (verbose_level)
+                        cout << "Worker " << i << " connected from " <<
+                            socket->remote_endpoint() << "\n";
+                    thrds.emplace_back([this, i, socket, verbose_level] {
+                        _serve(i, *socket, verbose_level);
+                    });
+                }
+                if (_num_connected != _num_workers && verbose_level)
+                    cout << "Missing workers: " << _num_workers - _num_connected <<
+                        " of " << _num_workers << "\n";
+                for (auto &&t : thrds)
+                    t.join();
+
+                if (verbose_level) {
+                    cout << "Total offers: " << _num_offers << "\n";
+                    cout << "Total replies with states: " << _num_sent << "\n";
+                    if (_has_best)
+                        cout << "Global min energy: " << _best_energy << "\n";
+                }
+                return _has_best;
+            }
+
+            // Global best state, valid if run returned true.
+            const snapshot_t &best() const noexcept {
+                return _best;
+            }
+
+            double best_energy() const noexcept {
+                return _best_energy;
+            }
+
+            // Offers received, and replies holding the global best sent.
+            std::size_t num_offers() const noexcept {
+                return _num_offers;
+            }
+
+            std::size_t num_sent() const noexcept {
+                return _num_sent;
+            }
+
+            // Workers connected by the last run, fewer than num_workers if 
+            // some were missing.
+            std::size_t num_connected() const noexcept {
+                return _num_connected;
+            }
+
+        private:
+            // Accepts a connection to socket unless deadline passes first.
+            // Returns: whether one was accepted
+            bool _accept(tcp::socket &socket, std::chrono::steady_clock::time_point deadline) {
+                boost::system::error_code ec = boost::asio::error::would_block;
+                _acceptor.async_accept(socket, [&ec](const boost::system::error_code &e) {
+                    ec = e;
+                });
+                _io.restart();
+                _io.run_until(deadline);
+                if (ec == boost::asio::error::would_block) {
+                    _acceptor.cancel();     // Completes the accept as aborted
+                    _io.restart();
+                    _io.run();
+                    return false;
+                }
+                return !ec;
+            }
+
+            void _serve(std::size_t id, tcp::socket &socket, unsigned verbose_level) {
+                using namespace std;
+                message_t msg, reply;
+                vector<uint8_t> buf;
+                try {
+                    for (;;) {
+                        read_message(socket, _n, msg, buf);
+                        reply.kind = message_kind::reply;
+                        reply.snap = snapshot_t();
+                        {
+                            lock_guard<mutex> lck(_best_mutex);
+                            if (!_has_best || msg.energy < _best_energy) {
+                                _best = msg.snap;
+                                _best_energy = msg.energy;
+                                _has_best = true;
+                            } else if (msg.kind == message_kind::offer &&
+                                _best_energy < msg.energy) {
+                                reply.snap = _best;
+                                reply.energy = _best_energy;
+                                ++_num_sent;
+                            }
+                            if (msg.kind == message_kind::offer)
+                                ++_num_offers;
+                        }
+                        if (msg.kind == message_kind::done) {
+                            if (verbose_level)
+                                cout << "Worker " << id << " done with energy " <<
+                                    msg.energy << "\n";
+                            return;
+                        }
+                        write_message(socket, reply, buf);
+                    }
+                } catch (const exception &e) {
+                    if (verbose_level)
+                        cout << "Worker " << id << " dropped: " << e.what() << "\n";
+                }
+            }
+
+            boost::asio::io_context _io;
+            tcp::acceptor _acceptor;
+            std::size_t _num_workers, _n, _num_connected = 0;
+            std::chrono::milliseconds _accept_timeout;
+            std::mutex _best_mutex;
+            snapshot_t _best;
+            double _best_energy = 0;
+            bool _has_best = false;
+            std::size_t _num_offers = 0, _num_sent = 0;
+        };
+
+        // Island connected to a coordinator. If the connection is lost the
+        // island keeps annealing alone.
+        class IslandWorker {
+        public:
+            using tcp = boost::asio::ip::tcp;
+            using migration_t = SaPackerBase::migration_t;
+
+            // Connects to host:port, retrying for the coordinator to start.
+            // Throws: boost::system::system_error if every attempt fails
+            IslandWorker(const std::string &host, unsigned short port, std::size_t n,
+                unsigned attempts = 50,
+                std::chrono::milliseconds retry_interval = std::chrono::milliseconds(100)) :
+                _socket(_io), _n(n) {
+                tcp::resolver resolver(_io);
+                auto endpoints = resolver.resolve(host, std::to_string(port));
+                for (;;) {
+                    try {
+                        boost::asio::connect(_socket, endpoints);
+                        break;
+                    } catch (const boost::system::system_error &) {
+                        if (--attempts == 0)
+                            throw;
+                        std::this_thread::sleep_for(retry_interval);
+                    }
+                }
+            }
+
+            // Offers best. Returns: whether incoming holds a better state
+            bool exchange(const snapshot_t &best, double best_energy,
+                snapshot_t &incoming, double &incoming_energy) {
+                if (!_connected)
+                    return false;
+                try {
+                    _msg.kind = message_kind::offer;
+                    _msg.energy = best_energy;
+                    _msg.snap = best;
+                    write_message(_socket, _msg, _buf);
+                    read_message(_socket, _n, _msg, _buf);
+                } catch (const std::exception &) {
+                    _connected = false;
+                    return false;
+                }
+                if (_msg.kind != message_kind::reply || _msg.snap.sp_x.empty())
+                    return false;
+                incoming = std::move(_msg.snap);
+                incoming_energy = _msg.energy;
+                return true;
+            }
+
+            // Sends the final best and closes the connection.
+            void finish(const snapshot_t &best, double best_energy) {
+                if (!_connected)
+                    return;
+                try {
+                    _msg.kind = message_kind::done;
+                    _msg.energy = best_energy;
+                    _msg.snap = best;
+                    write_message(_socket, _msg, _buf);
+                    _socket.close();
+                } catch (const std::exception &) { }
+                _connected = false;
+            }
+
+            // Migration exchanging every interval temperatures by me, which
+            // must outlive its use.
+            migration_t migration(std::size_t interval) {
+                migration_t m;
+                m.interval = interval;
+                m.exchange = [this](const snapshot_t &best, double best_energy,
+                    snapshot_t &incoming, double &incoming_energy) {
+                    return exchange(best, best_energy, incoming, incoming_energy);
+                };
+                return m;
+            }
+
+            bool connected() const noexcept {
+                return _connected;
+            }
+
+        private:
+            boost::asio::io_context _io;
+            tcp::socket _socket;
+            std::size_t _n;
+            bool _connected = true;
+            message_t _msg;
+            std::vector<std::uint8_t> _buf;
+        };
+    }
+}
@@ -2,8 +2,12 @@
 // Rewritten by LYL (Aureliano Lee)
 
 #pragma once
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <boost/foreach.hpp>
@@ -12,13 +16,24 @@
 
 namespace rect_packing {    
 
+    // Type wide enough for areas of Coord coordinates: at least 64 bits.
+    template<typename Coord>
+    using area_type_for = std::conditional_t<(sizeof(Coord) < sizeof(std::int64_t)),
+        std::int64_t, Coord>;
+
     // LayoutBase only stores the bottom-left positions of components. 
-    // Widths and heights are shared. 
-    template<typename Alloc = std::allocator<void> >
+    // Widths and heights are shared. Coord is a signed integer type of 
+    // coordinates, which may be narrowed to save cache for small floorplans, 
+    // or widened for huge ones.
+    template<typename Alloc = std::allocator<void>, typename Coord = int>
     class LayoutBase {
+        static_assert(std::is_signed<Coord>::value, "Coord must be signed");
+
     public:
         using allocator_type = Alloc;
-        using pos_vector_t = std::vector<int, allocator_type>;
+        using coordinate_type = Coord;
+        using area_type = area_type_for<Coord>;
+        using pos_vector_t = std::vector<Coord, allocator_type>;
 
         LayoutBase() : LayoutBase(0) { }
 
@@ -29,23 +44,24 @@ namespace rect_packing {
             _x(sz, alloc), _y(sz, alloc) { }
 
         template<typename Vctr0, typename Vctr1>
-        std::pair<int, int> get_area(const Vctr0 &widths,
+        std::pair<Coord, Coord> get_area(const Vctr0 &widths,
             const Vctr1 &heights) const {
-            int lX = INT_MAX, rX = INT_MIN, bY = INT_MAX, tY = INT_MIN;
-            int x, y, w, h;
+            using limits = std::numeric_limits<Coord>;
+            Coord lX = limits::max(), rX = limits::min(), 
+                bY = limits::max(), tY = limits::min();
+            Coord x, y, w, h;
             BOOST_FOREACH(boost::tie(x, y, w, h),
                 boost::combine(_x, _y, widths, heights)) {
-                Rect r(x, y, w, h);
-                if (lX > r.left())
-                    lX = r.left();
-                if (rX < r.right())
-                    rX = r.right();
-                if (bY > r.bottom())
-                    bY = r.bottom();
-                if (tY < r.top())
-                    tY = r.top();
+                if (lX > x)
+                    lX = x;
+                if (rX < x + w)
+                    rX = x + w;
+                if (bY > y)
+                    bY = y;
+                if (tY < y + h)
+                    tY = y + h;
             }
-            return { rX - lX, tY - bY };
+            return std::pair<Coord, Coord>(rX - lX, tY - bY);
         }
 
         // Note: not used.
@@ -97,11 +113,11 @@ namespace rect_packing {
             return _y;
         }
 
-        void set_x(std::size_t k, int x) {
+        void set_x(std::size_t k, Coord x) {
             _x[k] = x;
         }
 
-        void set_y(std::size_t k, int y) {
+        void set_y(std::size_t k, Coord y) {
             _y[k] = y;
         }
 
@@ -143,21 +159,23 @@ namespace rect_packing {
 
 
     // General layout.
-    template<typename Alloc = std::allocator<void>>
-    class Layout : public LayoutBase<Alloc> {
-        using self_t = Layout<Alloc>;
-        using base_t = LayoutBase<Alloc>;
+    template<typename Alloc = std::allocator<void>, typename Coord = int>
+    class Layout : public LayoutBase<Alloc, Coord> {
+        using self_t = Layout<Alloc, Coord>;
+        using base_t = LayoutBase<Alloc, Coord>;
 
     public:
         using typename base_t::allocator_type;
+        using typename base_t::coordinate_type;
+        using typename base_t::area_type;
         using typename base_t::pos_vector_t;
-        using size_vector_t = std::vector<int, allocator_type>;
+        using size_vector_t = std::vector<Coord, allocator_type>;
         using format_policy = typename Rect::format_policy;
 
         struct formatted {
-            formatted(const Layout<Alloc> &layout, format_policy policy) :
+            formatted(const self_t &layout, format_policy policy) :
                 layout(layout), policy(policy) { }
-            const Layout<Alloc> &layout;
+            const self_t &layout;
             format_policy policy;
         };
 
@@ -179,7 +197,7 @@ namespace rect_packing {
         }
 
         // Pushes fixed-size component.
-        void push(int width, int height) {
+        void push(Coord width, Coord height) {
             _widths.push_back(width);
             _heights.push_back(height);
             base_t::_x.emplace_back();
@@ -239,12 +257,13 @@ namespace rect_packing {
             return _heights.end();
         }
 
-        // Read-only Rect view.
+        // Read-only Rect view. Rect holds int coordinates.
         Rect rect(std::size_t k) const {
-            return Rect(base_t::_x[k], base_t::_y[k], _widths[k], _heights[k]);
+            return Rect(static_cast<int>(base_t::_x[k]), static_cast<int>(base_t::_y[k]), 
+                static_cast<int>(_widths[k]), static_cast<int>(_heights[k]));
         }
 
-        std::pair<int, int> get_area() const noexcept {
+        std::pair<Coord, Coord> get_area() const noexcept {
             return base_t::get_area(_widths, _heights);
         }
 
@@ -257,15 +276,16 @@ namespace rect_packing {
             return formatted(*this, policy);
         }
 
-        int sum_conponent_areas() const {
-            return std::inner_product(widths_begin(), widths_end(), heights_begin(), 0);
+        area_type sum_conponent_areas() const {
+            return std::inner_product(widths_begin(), widths_end(), heights_begin(), 
+                area_type(0));
         }
 
-        friend std::istream &operator>>(std::istream &in, Layout<Alloc> &layout) {
+        friend std::istream &operator>>(std::istream &in, self_t &layout) {
             return layout._read(in);
         }
 
-        friend std::ostream &operator<<(std::ostream &out, const Layout<Alloc> &layout) {
+        friend std::ostream &operator<<(std::ostream &out, const self_t &layout) {
             return layout._print(out, format_policy::delim);
         }
 
@@ -274,22 +294,29 @@ namespace rect_packing {
         }
 
     protected:
+        // Reads "left bottom right top" per component as Rect does.
         std::istream &_read(std::istream &in) {
-            Rect r;
-            while (in >> r) {
-                base_t::_x.push_back(r.pos.x);
-                base_t::_y.push_back(r.pos.y);
-                _widths.push_back(r.width);
-                _heights.push_back(r.height);
+            Coord left, bottom, right, top;
+            while (in >> left >> bottom >> right >> top) {
+                base_t::_x.push_back(left);
+                base_t::_y.push_back(bottom);
+                _widths.push_back(right - left);
+                _heights.push_back(top - bottom);
             }
             return in;
         }
 
+        // Prints in the formats of Rect, which may not hold Coord.
         std::ostream &_print(std::ostream &out, format_policy policy) const {
-            int x, y, w, h;
+            Coord x, y, w, h;
             BOOST_FOREACH(boost::tie(x, y, w, h),
-                boost::combine(base_t::_x, base_t::_y, _widths, _heights))
-                out << Rect(x, y, w, h).format(policy) << "\n";
+                boost::combine(base_t::_x, base_t::_y, _widths, _heights)) {
+                if (policy == format_policy::delim)
+                    out << "(" << x << ", " << y << ") - (" << x + w << ", " << y + h << ")";
+                else
+                    out << x << " " << y << " " << x + w << " " << y + h;
+                out << "\n";
+            }
             return out;
         }
 
@@ -298,17 +325,18 @@ namespace rect_packing {
 
 
     namespace detail {
-        template<typename Alloc0, typename Alloc1>
-        void unguarded_copy_layout_positions(const LayoutBase<Alloc0> &src, 
-            LayoutBase<Alloc1> &dest) {
+        template<typename Alloc0, typename Alloc1, typename Coord>
+        void unguarded_copy_layout_positions(const LayoutBase<Alloc0, Coord> &src, 
+            LayoutBase<Alloc1, Coord> &dest) {
             assert(src.size() == dest.size());
             auto sz = src.size();
             std::copy(src.x().data(), src.x().data() + sz, addressof(*dest.x_begin()));
             std::copy(src.y().data(), src.y().data() + sz, addressof(*dest.y_begin()));
         }
 
-        template<typename Alloc0, typename Alloc1>
-        void unguarded_copy_layout_sizes(const Layout<Alloc0> &src, Layout<Alloc1> &dest) {
+        template<typename Alloc0, typename Alloc1, typename Coord>
+        void unguarded_copy_layout_sizes(const Layout<Alloc0, Coord> &src, 
+            Layout<Alloc1, Coord> &dest) {
             assert(src.size() == dest.size());
             auto sz = src.size();
             std::copy(src.widths().data(), src.widths().data() + sz, 
@@ -317,8 +345,8 @@ namespace rect_packing {
                 addressof(*dest.heights_begin()));
         }
 
-        template<typename Alloc0, typename Alloc1>
-        void unguarded_copy_layout(const Layout<Alloc0> &src, Layout<Alloc1> &dest) {
+        template<typename Alloc0, typename Alloc1, typename Coord>
+        void unguarded_copy_layout(const Layout<Alloc0, Coord> &src, Layout<Alloc1, Coord> &dest) {
             unguarded_copy_layout_sizes(src, dest);
             unguarded_copy_layout_positions(src, dest);
         }
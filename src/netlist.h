@@ -0,0 +1,363 @@
+// netlist.h: class Netlist of multi-pin nets (hypernets).
+// Author: LYL (Aureliano Lee)
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rect_packing {
+
+    // Netlist stores the pins (component indices) of all nets contiguously,
+    // where net k owns pins [offsets()[k], offsets()[k + 1]). Iterating a
+    // Netlist gives a pin range per net.
+    class Netlist {
+    public:
+        using pin_vector_t = std::vector<std::size_t>;
+
+        // Pins of one net.
+        class net_view {
+        public:
+            using const_iterator = const std::size_t *;
+
+            net_view(const_iterator first, const_iterator last) noexcept :
+                _first(first), _last(last) { }
+
+            const_iterator begin() const noexcept {
+                return _first;
+            }
+
+            const_iterator end() const noexcept {
+                return _last;
+            }
+
+            std::size_t size() const noexcept {
+                return _last - _first;
+            }
+
+        private:
+            const_iterator _first, _last;
+        };
+
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = net_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = net_view;
+
+            const_iterator() = default;
+
+            const_iterator(const Netlist &netlist, std::size_t k) noexcept :
+                _netlist(&netlist), _k(k) { }
+
+            net_view operator*() const noexcept {
+                return _netlist->net(_k);
+            }
+
+            const_iterator &operator++() noexcept {
+                ++_k;
+                return *this;
+            }
+
+            const_iterator operator++(int) noexcept {
+                auto old = *this;
+                ++_k;
+                return old;
+            }
+
+            bool operator==(const const_iterator &other) const noexcept {
+                return _k == other._k;
+            }
+
+            bool operator!=(const const_iterator &other) const noexcept {
+                return _k != other._k;
+            }
+
+        private:
+            const Netlist *_netlist = nullptr;
+            std::size_t _k = 0;
+        };
+
+        Netlist() : _offsets(1, 0) { }
+
+        // Constructs two-pin nets from pairs [first, last).
+        template<typename FwdIt>
+        Netlist(FwdIt first, FwdIt last) : Netlist() {
+            using namespace std;
+            for (; first != last; ++first) {
+                size_t pins[] = { get<0>(*first), get<1>(*first) };
+                push(pins, pins + 2);
+            }
+        }
+
+        // Appends a net of pins [first, last).
+        template<typename InIt>
+        void push(InIt first, InIt last) {
+            _pins.insert(_pins.end(), first, last);
+            _offsets.push_back(_pins.size());
+        }
+
+        std::size_t size() const noexcept {
+            return _offsets.size() - 1;
+        }
+
+        bool empty() const noexcept {
+            return size() == 0;
+        }
+
+        std::size_t num_pins() const noexcept {
+            return _pins.size();
+        }
+
+        // Maximum number of pins of a net.
+        std::size_t max_degree() const noexcept {
+            std::size_t deg = 0;
+            for (std::size_t k = 0; k != size(); ++k)
+                deg = std::max(deg, _offsets[k + 1] - _offsets[k]);
+            return deg;
+        }
+
+        const pin_vector_t &offsets() const noexcept {
+            return _offsets;
+        }
+
+        const pin_vector_t &pins() const noexcept {
+            return _pins;
+        }
+
+        net_view net(std::size_t k) const noexcept {
+            return net_view(_pins.data() + _offsets[k], _pins.data() + _offsets[k + 1]);
+        }
+
+        const_iterator begin() const noexcept {
+            return const_iterator(*this, 0);
+        }
+
+        const_iterator end() const noexcept {
+            return const_iterator(*this, size());
+        }
+
+        void clear() noexcept {
+            _offsets.resize(1);
+            _pins.clear();
+        }
+
+        // Reads a net of whitespace separated pins per line, so files of
+        // pairs read as two-pin nets. Empty lines are skipped.
+        friend std::istream &operator>>(std::istream &in, Netlist &netlist) {
+            std::string line;
+            std::vector<std::size_t> pins;
+            while (std::getline(in, line)) {
+                std::istringstream line_in(line);
+                pins.clear();
+                std::size_t pin;
+                while (line_in >> pin)
+                    pins.push_back(pin);
+                if (!line_in.eof()) {
+                    in.setstate(std::ios_base::failbit);
+                    break;
+                }
+                if (!pins.empty())
+                    netlist.push(pins.cbegin(), pins.cend());
+            }
+            return in;
+        }
+
+        // Prints a net per line.
+        friend std::ostream &operator<<(std::ostream &out, const Netlist &netlist) {
+            for (auto net : netlist) {
+                const char *delim = "";
+                for (auto pin : net) {
+                    out << delim << pin;
+                    delim = " ";
+                }
+                out << "\n";
+            }
+            return out;
+        }
+
+    private:
+        pin_vector_t _offsets;  // Size of size() + 1
+        pin_vector_t _pins;
+    };
+
+    // TwoPinNetlist stores the endpoints of two-pin nets as two arrays of 
+    // 32-bit indices, which wirelength kernels gather from directly. Iterating
+    // it gives pairs of endpoints like a range of std::pair.
+    class TwoPinNetlist {
+    public:
+        using index_type = std::uint32_t;
+        using index_vector_t = std::vector<index_type>;
+
+        class const_iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::pair<std::size_t, std::size_t>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            const_iterator() = default;
+
+            const_iterator(const TwoPinNetlist &netlist, std::size_t k) noexcept :
+                _netlist(&netlist), _k(k) { }
+
+            value_type operator*() const noexcept {
+                return value_type(_netlist->_first[_k], _netlist->_second[_k]);
+            }
+
+            value_type operator[](difference_type d) const noexcept {
+                return *(*this + d);
+            }
+
+            const_iterator &operator++() noexcept {
+                ++_k;
+                return *this;
+            }
+
+            const_iterator operator++(int) noexcept {
+                auto old = *this;
+                ++_k;
+                return old;
+            }
+
+            const_iterator &operator--() noexcept {
+                --_k;
+                return *this;
+            }
+
+            const_iterator operator--(int) noexcept {
+                auto old = *this;
+                --_k;
+                return old;
+            }
+
+            const_iterator &operator+=(difference_type d) noexcept {
+                _k += d;
+                return *this;
+            }
+
+            const_iterator &operator-=(difference_type d) noexcept {
+                _k -= d;
+                return *this;
+            }
+
+            friend const_iterator operator+(const_iterator i, difference_type d) noexcept {
+                return i += d;
+            }
+
+            friend const_iterator operator+(difference_type d, const_iterator i) noexcept {
+                return i += d;
+            }
+
+            friend const_iterator operator-(const_iterator i, difference_type d) noexcept {
+                return i -= d;
+            }
+
+            friend difference_type operator-(const const_iterator &lhs,
+                const const_iterator &rhs) noexcept {
+                return static_cast<difference_type>(lhs._k) - 
+                    static_cast<difference_type>(rhs._k);
+            }
+
+            bool operator==(const const_iterator &other) const noexcept {
+                return _k == other._k;
+            }
+
+            bool operator!=(const const_iterator &other) const noexcept {
+                return _k != other._k;
+            }
+
+            bool operator<(const const_iterator &other) const noexcept {
+                return _k < other._k;
+            }
+
+            bool operator>(const const_iterator &other) const noexcept {
+                return _k > other._k;
+            }
+
+            bool operator<=(const const_iterator &other) const noexcept {
+                return _k <= other._k;
+            }
+
+            bool operator>=(const const_iterator &other) const noexcept {
+                return _k >= other._k;
+            }
+
+            const TwoPinNetlist &netlist() const noexcept {
+                return *_netlist;
+            }
+
+            // Position of the net in netlist().
+            std::size_t index() const noexcept {
+                return _k;
+            }
+
+        private:
+            const TwoPinNetlist *_netlist = nullptr;
+            std::size_t _k = 0;
+        };
+
+        TwoPinNetlist() = default;
+
+        // Constructs from pairs [first, last).
+        template<typename FwdIt>
+        TwoPinNetlist(FwdIt first, FwdIt last) {
+            using namespace std;
+            for (; first != last; ++first)
+                push(get<0>(*first), get<1>(*first));
+        }
+
+        // Appends net (i, j). Throws std::out_of_range if an index exceeds 
+        // index_type.
+        void push(std::size_t i, std::size_t j) {
+            using limits = std::numeric_limits<index_type>;
+            if (i > limits::max() || j > limits::max())
+                throw std::out_of_range("Pin index too large");
+            _first.push_back(static_cast<index_type>(i));
+            _second.push_back(static_cast<index_type>(j));
+        }
+
+        std::size_t size() const noexcept {
+            return _first.size();
+        }
+
+        bool empty() const noexcept {
+            return _first.empty();
+        }
+
+        const index_vector_t &firsts() const noexcept {
+            return _first;
+        }
+
+        const index_vector_t &seconds() const noexcept {
+            return _second;
+        }
+
+        const_iterator begin() const noexcept {
+            return const_iterator(*this, 0);
+        }
+
+        const_iterator end() const noexcept {
+            return const_iterator(*this, size());
+        }
+
+        void clear() noexcept {
+            _first.clear();
+            _second.clear();
+        }
+
+    private:
+        index_vector_t _first, _second;
+    };
+}
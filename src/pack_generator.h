@@ -6,21 +6,33 @@
 #include "xseqpair.h"
 #include <algorithm>
 #include <array>
+#include <bitset>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <numeric>
 #include <random>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 #include <boost/container/pmr/map.hpp>
-#include <boost/property_map/property_map.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/dag_shortest_paths.hpp>
-#include <boost/graph/graph_traits.hpp>
 #include "aureliano/toolbox.h"
 #include "layout.h"
+#include "random_engine.h"
 
 namespace rect_packing {
     namespace detail {
@@ -49,6 +61,63 @@ namespace rect_packing {
             return match;
         }
 
+        // Crossovers of permutations p and q of [0, n) into child, which
+        // keeps positions [i, j) of p. inv_p is the inverse of p.
+        // Partially mapped crossover (PMX): other positions are of q, where
+        // values clashing with the segment are mapped through it.
+        template<typename RanIt0, typename RanIt1, typename RanIt2, typename RanIt3>
+        void pmx_crossover(RanIt0 p, RanIt1 inv_p, RanIt2 q, std::size_t n,
+            std::size_t i, std::size_t j, RanIt3 child) {
+            for (std::size_t k = 0; k != n; ++k) {
+                if (k >= i && k < j) {
+                    child[k] = p[k];
+                    continue;
+                }
+                auto v = q[k];
+                for (std::size_t m = inv_p[v]; m >= i && m < j; m = inv_p[v])
+                    v = q[m];
+                child[k] = v;
+            }
+        }
+
+        // Order crossover (OX): other positions, from j on cyclically, are 
+        // the rest of values in the order of q from j on.
+        template<typename RanIt0, typename RanIt1, typename RanIt2, typename RanIt3>
+        void order_crossover(RanIt0 p, RanIt1 inv_p, RanIt2 q, std::size_t n,
+            std::size_t i, std::size_t j, RanIt3 child) {
+            std::copy(p + i, p + j, child + i);
+            auto k = j % n;
+            for (std::size_t t = 0; t != n; ++t) {
+                auto v = q[(j + t) % n];
+                std::size_t m = inv_p[v];
+                if (m >= i && m < j)
+                    continue;
+                child[k] = v;
+                k = k + 1 == n ? 0 : k + 1;
+            }
+        }
+
+        // Cycle crossover (CX): positions of alternate cycles of (p, q) are 
+        // of p and q, starting with p. Segment [i, j) is unused. taken holds
+        // n flags, all false.
+        template<typename RanIt0, typename RanIt1, typename RanIt2, typename RanIt3,
+            typename Flags>
+        void cycle_crossover(RanIt0 p, RanIt1 inv_p, RanIt2 q, std::size_t n,
+            RanIt3 child, Flags &taken) {
+            bool from_p = true;
+            for (std::size_t s = 0; s != n; ++s) {
+                if (taken[s])
+                    continue;
+                auto k = s;
+                do {
+                    taken[k] = true;
+                    child[k] = from_p ? p[k] : q[k];
+                    k = inv_p[q[k]];
+                } while (k != s);
+                from_p = !from_p;
+            }
+        }
+
         // Fast LCS evaluation in O(nlogn).
         template<typename FwdIt0, typename FwdIt1,
             typename RanIt0, typename RanIt1,
@@ -86,6 +155,648 @@ namespace rect_packing {
             return pq.rbegin()->second;
         }
 
+        // Fast LCS evaluation in O(nlogn) with a flat Fenwick tree of prefix
+        // maximums instead of a node-based map. Gives the same positions as
+        // eval_sp2. Assuming tree is big enough to hold [0, n).
+        template<typename FwdIt0, typename FwdIt1,
+            typename RanIt0, typename RanIt1,
+            typename RanIt2, typename RanIt3, typename RanIt4>
+            auto eval_sp2_fenwick(FwdIt0 y_begin, FwdIt0 y_end,  // in
+                FwdIt1 x_begin, RanIt0 len,                     // in
+                RanIt1 pos,                                     // out
+                RanIt2 buffer, RanIt3 match, RanIt4 tree) {     // auxilary
+            using value_type = typename std::iterator_traits<RanIt4>::value_type;
+            using size_type = std::make_unsigned_t<
+                typename std::iterator_traits<RanIt3>::value_type>;
+
+            rect_packing::detail::make_match(y_begin, y_end, x_begin, match, buffer);
+
+            const auto sz = static_cast<size_type>(std::distance(y_begin, y_end));
+            std::fill(tree, tree + sz, value_type(0));
+            value_type ans = 0;
+            for (size_type i = 0; i != sz; ++i) {
+                auto b = *x_begin++;
+                auto p = static_cast<size_type>(match[i]);
+                // Max top among keys in [0, p), tree[k - 1] covers (k - lowbit(k), k]
+                value_type t = 0;
+                for (auto k = p; k; k &= k - 1)
+                    t = std::max(t, tree[k - 1]);
+                pos[b] = t;
+                t += len[b];
+                for (auto k = p + 1; k <= sz; k += k & (~k + 1))
+                    tree[k - 1] = std::max(tree[k - 1], t);
+                ans = std::max(ans, t);
+            }
+            return ans;
+        }
+
+        // Index of the lowest set bit. Requires: x != 0.
+        inline unsigned lowest_bit_index(std::uint64_t x) noexcept {
+#ifdef _MSC_VER
+            unsigned long k;
+            _BitScanForward64(&k, x);
+            return static_cast<unsigned>(k);
+#else
+            return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+        }
+
+        // Index of the highest set bit. Requires: x != 0.
+        inline unsigned highest_bit_index(std::uint64_t x) noexcept {
+#ifdef _MSC_VER
+            unsigned long k;
+            _BitScanReverse64(&k, x);
+            return static_cast<unsigned>(k);
+#else
+            return 63u - static_cast<unsigned>(__builtin_clzll(x));
+#endif
+        }
+
+        // Integer set on [0, n) in van Emde Boas style, with 64-bit words as
+        // leaves: every level summarizes the non-empty words of the level below,
+        // so predecessor / successor visit O(log_64(n)) words.
+        // Does not own memory.
+        class VebSet {
+        public:
+            using word_t = std::uint64_t;
+            static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+            static constexpr unsigned max_levels = 11;  // 64 ** 11 > 2 ** 64
+
+            // Number of words needed to hold [0, n).
+            static std::size_t words_needed(std::size_t n) noexcept {
+                std::size_t ans = 0;
+                do {
+                    n = (n + 63) >> 6;
+                    ans += n;
+                } while (n > 1);
+                return ans;
+            }
+
+            VebSet(word_t *words, std::size_t n) noexcept : _num_levels(0) {
+                do {
+                    n = (n + 63) >> 6;
+                    _levels[_num_levels] = words;
+                    _sizes[_num_levels++] = n;
+                    words += n;
+                } while (n > 1);
+            }
+
+            void clear() noexcept {
+                for (unsigned l = 0; l != _num_levels; ++l)
+                    std::fill(_levels[l], _levels[l] + _sizes[l], word_t(0));
+            }
+
+            void insert(std::size_t k) noexcept {
+                for (unsigned l = 0; l != _num_levels; ++l, k >>= 6) {
+                    auto &w = _levels[l][k >> 6];
+                    auto was_empty = !w;
+                    w |= word_t(1) << (k & 63);
+                    if (!was_empty)
+                        break;
+                }
+            }
+
+            void erase(std::size_t k) noexcept {
+                for (unsigned l = 0; l != _num_levels; ++l, k >>= 6) {
+                    auto &w = _levels[l][k >> 6];
+                    w &= ~(word_t(1) << (k & 63));
+                    if (w)
+                        break;
+                }
+            }
+
+            // Largest element less than k, or npos.
+            std::size_t predecessor(std::size_t k) const noexcept {
+                if (!k)
+                    return npos;
+                auto idx = k - 1;   // Inclusive bound on current level
+                for (unsigned l = 0; l != _num_levels; ++l) {
+                    auto m = _levels[l][idx >> 6] & (~word_t(0) >> (63 - (idx & 63)));
+                    if (m)
+                        return _descend_max(l, ((idx >> 6) << 6) | highest_bit_index(m));
+                    if (!(idx >> 6))
+                        return npos;
+                    idx = (idx >> 6) - 1;
+                }
+                return npos;
+            }
+
+            // Smallest element greater than k, or npos.
+            std::size_t successor(std::size_t k) const noexcept {
+                auto idx = k + 1;   // Inclusive bound on current level
+                for (unsigned l = 0; l != _num_levels; ++l) {
+                    if ((idx >> 6) >= _sizes[l])
+                        return npos;
+                    auto m = _levels[l][idx >> 6] & (~word_t(0) << (idx & 63));
+                    if (m)
+                        return _descend_min(l, ((idx >> 6) << 6) | lowest_bit_index(m));
+                    idx = (idx >> 6) + 1;
+                }
+                return npos;
+            }
+
+        protected:
+            std::size_t _descend_max(unsigned l, std::size_t k) const noexcept {
+                while (l--)
+                    k = (k << 6) | highest_bit_index(_levels[l][k]);
+                return k;
+            }
+
+            std::size_t _descend_min(unsigned l, std::size_t k) const noexcept {
+                while (l--)
+                    k = (k << 6) | lowest_bit_index(_levels[l][k]);
+                return k;
+            }
+
+            std::array<word_t *, max_levels> _levels;
+            std::array<std::size_t, max_levels> _sizes;
+            unsigned _num_levels;
+        };
+
+        // Rounds n bytes up to whole words, so that arrays of different types
+        // can share a resource buffer.
+        constexpr std::size_t aligned_bytes(std::size_t n) noexcept {
+            return (n + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t) * 
+                sizeof(std::uint64_t);
+        }
+
+        // Fast LCS evaluation in O(nloglogn) in the manner of FAST-SP: the
+        // staircase keys live in a VebSet and their values in a flat array.
+        // Gives the same positions as eval_sp2. Assuming words holds
+        // VebSet::words_needed(n) words and vals holds [0, n).
+        template<typename FwdIt0, typename FwdIt1,
+            typename RanIt0, typename RanIt1,
+            typename RanIt2, typename RanIt3, typename RanIt4>
+            auto eval_sp2_veb(FwdIt0 y_begin, FwdIt0 y_end,      // in
+                FwdIt1 x_begin, RanIt0 len,                     // in
+                RanIt1 pos,                                     // out
+                RanIt2 buffer, RanIt3 match,                    // auxilary
+                typename VebSet::word_t *words, RanIt4 vals) {  // auxilary
+            using value_type = typename std::iterator_traits<RanIt4>::value_type;
+            constexpr auto npos = VebSet::npos;
+
+            rect_packing::detail::make_match(y_begin, y_end, x_begin, match, buffer);
+
+            const auto sz = static_cast<std::size_t>(std::distance(y_begin, y_end));
+            VebSet pq(words, sz);
+            pq.clear();
+            for (std::size_t i = 0; i != sz; ++i) {
+                auto b = *x_begin++;
+                auto p = static_cast<std::size_t>(match[i]);
+                auto q = pq.predecessor(p);
+                pos[b] = q == npos ? value_type(0) : vals[q];
+                value_type t = pos[b] + len[b];
+                pq.insert(p);
+                vals[p] = t;
+                // Values of the staircase increase with keys
+                for (auto s = pq.successor(p); s != npos && vals[s] <= t;
+                    s = pq.successor(s))
+                    pq.erase(s);
+            }
+
+            auto last = pq.predecessor(sz);
+            return last == npos ? value_type(0) : vals[last];
+        }
+
+        // Lanes of the vector unit eval_sp2_simd is compiled for.
+#if defined(__AVX2__)
+        constexpr std::size_t simd_lanes = 8;
+#elif defined(__SSE2__) || defined(_M_X64)
+        constexpr std::size_t simd_lanes = 4;
+#else
+        constexpr std::size_t simd_lanes = 1;
+#endif
+
+        // Largest instance where eval_sp2_simd is preferred, about where 
+        // eval_sp2_fenwick catches up with the vector width compiled for.
+        constexpr std::size_t simd_max_size = 
+            simd_lanes >= 8 ? 128 : simd_lanes >= 4 ? 32 : 0;
+
+        // Number of elements of prefix maximums needed by eval_sp2_simd for 
+        // n components: [0, n] padded to whole vectors.
+        constexpr std::size_t simd_tops_size(std::size_t n) noexcept {
+            return (n + simd_lanes) / simd_lanes * simd_lanes;
+        }
+
+        // Raises tops[k] to at least t for every k in (p, sz) without branching
+        // on the data. sz is a multiple of simd_lanes, and 0 <= t.
+        inline void simd_raise_suffix(std::int32_t *tops, std::size_t sz,
+            std::size_t p, std::int32_t t) noexcept {
+#if defined(__AVX2__)
+            const auto tv = _mm256_set1_epi32(t);
+            auto k = (p + 1) & ~std::size_t(7);
+            // Lanes at or before p of the first vector are masked to 0
+            auto idx = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(k)),
+                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            auto mask = _mm256_cmpgt_epi32(idx, _mm256_set1_epi32(static_cast<int>(p)));
+            auto addr = reinterpret_cast<__m256i *>(tops + k);
+            _mm256_storeu_si256(addr, _mm256_max_epi32(_mm256_loadu_si256(addr),
+                _mm256_and_si256(mask, tv)));
+            for (k += 8; k < sz; k += 8) {
+                addr = reinterpret_cast<__m256i *>(tops + k);
+                _mm256_storeu_si256(addr, _mm256_max_epi32(_mm256_loadu_si256(addr), tv));
+            }
+#elif defined(__SSE2__) || defined(_M_X64)
+            auto max_epi32 = [](__m128i a, __m128i b) {
+#ifdef __SSE4_1__
+                return _mm_max_epi32(a, b);
+#else
+                auto gt = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+#endif
+            };
+            const auto tv = _mm_set1_epi32(t);
+            auto k = (p + 1) & ~std::size_t(3);
+            // Lanes at or before p of the first vector are masked to 0
+            auto idx = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(k)),
+                _mm_setr_epi32(0, 1, 2, 3));
+            auto mask = _mm_cmpgt_epi32(idx, _mm_set1_epi32(static_cast<int>(p)));
+            auto addr = reinterpret_cast<__m128i *>(tops + k);
+            _mm_storeu_si128(addr, max_epi32(_mm_loadu_si128(addr), _mm_and_si128(mask, tv)));
+            for (k += 4; k < sz; k += 4) {
+                addr = reinterpret_cast<__m128i *>(tops + k);
+                _mm_storeu_si128(addr, max_epi32(_mm_loadu_si128(addr), tv));
+            }
+#else
+            for (auto k = p + 1; k < sz; ++k)
+                tops[k] = std::max(tops[k], t);
+#endif
+        }
+
+        // LCS evaluation in O(n^2 / simd_lanes) for small instances, where the
+        // constant beats pointer-based structures. tops[k] is the maximum top
+        // of the components placed with keys less than k, so a position is a
+        // single load, and placing a component raises the suffix after its key
+        // with vector maximums. Gives the same positions as eval_sp2, provided
+        // that they fit in std::int32_t. Assuming tops holds simd_tops_size(n)
+        // elements.
+        template<typename FwdIt0, typename FwdIt1,
+            typename RanIt0, typename RanIt1,
+            typename RanIt2, typename RanIt3>
+            auto eval_sp2_simd(FwdIt0 y_begin, FwdIt0 y_end,     // in
+                FwdIt1 x_begin, RanIt0 len,                     // in
+                RanIt1 pos,                                     // out
+                RanIt2 buffer, RanIt3 match,                    // auxilary
+                std::int32_t *tops) {                           // auxilary
+            rect_packing::detail::make_match(y_begin, y_end, x_begin, match, buffer);
+
+            const auto sz = static_cast<std::size_t>(std::distance(y_begin, y_end));
+            const auto tops_size = simd_tops_size(sz);
+            std::fill(tops, tops + tops_size, std::int32_t(0));
+            for (std::size_t i = 0; i != sz; ++i) {
+                auto b = *x_begin++;
+                auto p = static_cast<std::size_t>(match[i]);
+                pos[b] = tops[p];
+                simd_raise_suffix(tops, tops_size, p, 
+                    tops[p] + static_cast<std::int32_t>(len[b]));
+            }
+            return static_cast<std::ptrdiff_t>(tops[sz]);
+        }
+
+        // Fused x and y passes of eval_sp2_fenwick given keys inv_y = inv(y)
+        // instead of y: the x pass walks x forward and the y pass walks it
+        // backward, so both dimensions share the loads of keys and their 
+        // dependency chains interleave. Assuming trees hold [0, n).
+        // Stops as soon as a component reaches reject_width, returning its 
+        // right end as the width and 0 as the height.
+        // Returns: (width, height)
+        template<typename RanIt0, typename RanIt1, typename RanIt2,
+            typename RanIt3, typename RanIt4>
+            auto eval_sp2_xy_fenwick(RanIt0 x_begin, RanIt0 x_end,  // in
+                RanIt1 inv_y, RanIt2 widths, RanIt2 heights,        // in
+                RanIt3 x_pos, RanIt3 y_pos,                         // out
+                RanIt4 x_tree, RanIt4 y_tree,                       // auxilary
+                typename std::iterator_traits<RanIt4>::value_type reject_width = 
+                std::numeric_limits<typename std::iterator_traits<RanIt4>::value_type>::max()) {
+            using value_type = typename std::iterator_traits<RanIt4>::value_type;
+
+            const auto sz = static_cast<std::size_t>(std::distance(x_begin, x_end));
+            std::fill(x_tree, x_tree + sz, value_type(0));
+            std::fill(y_tree, y_tree + sz, value_type(0));
+            for (std::size_t i = 0; i != sz; ++i) {
+                auto bx = x_begin[i], by = x_begin[sz - 1 - i];
+                auto px = static_cast<std::size_t>(inv_y[bx]);
+                auto py = static_cast<std::size_t>(inv_y[by]);
+                value_type tx = 0, ty = 0;
+                for (auto k = px; k; k &= k - 1)
+                    tx = std::max(tx, x_tree[k - 1]);
+                for (auto k = py; k; k &= k - 1)
+                    ty = std::max(ty, y_tree[k - 1]);
+                x_pos[bx] = tx;
+                y_pos[by] = ty;
+                tx += widths[bx];
+                ty += heights[by];
+                if (tx >= reject_width)
+                    return std::make_pair(tx, value_type(0));
+                for (auto k = px + 1; k <= sz; k += k & (~k + 1))
+                    x_tree[k - 1] = std::max(x_tree[k - 1], tx);
+                for (auto k = py + 1; k <= sz; k += k & (~k + 1))
+                    y_tree[k - 1] = std::max(y_tree[k - 1], ty);
+            }
+
+            value_type w = 0, h = 0;
+            for (auto k = sz; k; k &= k - 1) {
+                w = std::max(w, x_tree[k - 1]);
+                h = std::max(h, y_tree[k - 1]);
+            }
+            return std::make_pair(w, h);
+        }
+
+        // Fused x and y passes of eval_sp2_simd given keys inv_y = inv(y), in 
+        // the manner of eval_sp2_xy_fenwick, including reject_width. Assuming
+        // tops hold simd_tops_size(n) elements.
+        // Returns: (width, height)
+        template<typename RanIt0, typename RanIt1, typename RanIt2, typename RanIt3>
+            auto eval_sp2_xy_simd(RanIt0 x_begin, RanIt0 x_end,     // in
+                RanIt1 inv_y, RanIt2 widths, RanIt2 heights,        // in
+                RanIt3 x_pos, RanIt3 y_pos,                         // out
+                std::int32_t *x_tops, std::int32_t *y_tops,         // auxilary
+                std::int32_t reject_width = std::numeric_limits<std::int32_t>::max()) {
+            const auto sz = static_cast<std::size_t>(std::distance(x_begin, x_end));
+            const auto tops_size = simd_tops_size(sz);
+            std::fill(x_tops, x_tops + tops_size, std::int32_t(0));
+            std::fill(y_tops, y_tops + tops_size, std::int32_t(0));
+            for (std::size_t i = 0; i != sz; ++i) {
+                auto bx = x_begin[i], by = x_begin[sz - 1 - i];
+                auto px = static_cast<std::size_t>(inv_y[bx]);
+                auto py = static_cast<std::size_t>(inv_y[by]);
+                x_pos[bx] = x_tops[px];
+                y_pos[by] = y_tops[py];
+                auto tx = x_tops[px] + static_cast<std::int32_t>(widths[bx]);
+                if (tx >= reject_width)
+                    return std::make_pair(static_cast<std::ptrdiff_t>(tx), std::ptrdiff_t(0));
+                simd_raise_suffix(x_tops, tops_size, px, tx);
+                simd_raise_suffix(y_tops, tops_size, py,
+                    y_tops[py] + static_cast<std::int32_t>(heights[by]));
+            }
+            return std::make_pair(static_cast<std::ptrdiff_t>(x_tops[sz]),
+                static_cast<std::ptrdiff_t>(y_tops[sz]));
+        }
+
+        // Builds the transitive reduction of a constraint graph of sequence 
+        // pair (x, y) in CSR form, where sx, sy are inverses of x, y. If below
+        // is false, i -> j iff i is left of j (sx[i] < sx[j] && sy[i] < sy[j]),
+        // otherwise iff i is below j (sx[i] > sx[j] && sy[i] < sy[j]). Only edges
+        // without any component between their ends in both sequences are kept.
+        // offsets receives n + 1 entries, adj receives at most capacity edges.
+        // Returns: number of edges, which exceeds capacity if adj is too small.
+        template<typename RanIt0, typename RanIt1, typename RanIt2, typename RanIt3>
+        std::size_t make_reduced_constraint_graph(RanIt0 x, RanIt1 sx, RanIt1 sy,
+            std::size_t n, bool below, RanIt2 offsets, RanIt3 adj, 
+            std::size_t capacity) {
+            std::size_t m = 0;
+            auto add_edge_if_direct = [&](std::size_t j, std::size_t yi, 
+                std::size_t &bound) {
+                // Direct iff j is above every successor met before in x
+                if (sy[j] > yi && sy[j] < bound) {
+                    if (m < capacity)
+                        adj[m] = j;
+                    ++m;
+                    bound = sy[j];
+                }
+            };
+
+            for (std::size_t i = 0; i != n; ++i) {
+                offsets[i] = m;
+                const std::size_t yi = sy[i];
+                std::size_t bound = n;  // Least sy among successors met
+                if (!below) {
+                    for (std::size_t a = sx[i] + 1; a < n && bound > yi + 1; ++a)
+                        add_edge_if_direct(x[a], yi, bound);
+                } else {
+                    for (std::size_t a = sx[i]; a-- > 0 && bound > yi + 1; )
+                        add_edge_if_direct(x[a], yi, bound);
+                }
+            }
+            offsets[n] = m;
+            return m;
+        }
+
+        // Longest paths on a CSR DAG, relaxing vertices in topological order
+        // [first, last). Out-edges of v weigh len[v], and pos[v] receives the
+        // length of the longest path ending at v. Paths are relaxed in the
+        // scratch dist, so pos[v] is written once, when v is reached.
+        // Returns: max(pos[v] + len[v]).
+        template<typename FwdIt, typename RanIt0, typename RanIt1, 
+            typename RanIt2, typename RanIt3, typename RanIt4>
+        auto eval_longest_paths(FwdIt first, FwdIt last, RanIt0 offsets, 
+            RanIt1 adj, RanIt2 len, RanIt3 dist, RanIt4 pos) {
+            using value_type = std::decay_t<decltype(dist[*first] + len[*first])>;
+            for (auto i = first; i != last; ++i)
+                dist[*i] = 0;
+            value_type ans = 0;
+            for (; first != last; ++first) {
+                auto v = *first;
+                pos[v] = dist[v];
+                value_type t = dist[v] + len[v];
+                for (auto k = offsets[v]; k != offsets[v + 1]; ++k)
+                    if (dist[adj[k]] < t)
+                        dist[adj[k]] = t;
+                ans = std::max(ans, t);
+            }
+            return ans;
+        }
+
+        // Remembers the layout holding the component sizes of a generator, so
+        // that a move patches only the components it rotates instead of 
+        // copying all sizes. A component rotated (or rotated back) after the 
+        // last synchronization is stale. Two are kept, i.e. a rejected 
+        // rotation rolled back and the rotation of the next move; more force
+        // a full copy. Copies of this object, like generators copied, are not
+        // synchronized.
+        class LayoutSizeSync {
+        public:
+            static constexpr std::size_t max_stale = 2;
+
+            LayoutSizeSync() = default;
+            LayoutSizeSync(const LayoutSizeSync &) noexcept { }
+
+            LayoutSizeSync &operator=(const LayoutSizeSync &) noexcept {
+                reset();
+                return *this;
+            }
+
+            // Whether layout holds all sizes but [stale_begin(), stale_end()).
+            bool is_synced(const void *layout) const noexcept {
+                return layout == _layout;
+            }
+
+            const std::size_t *stale_begin() const noexcept {
+                return _stale.data();
+            }
+
+            const std::size_t *stale_end() const noexcept {
+                return _stale.data() + _num_stale;
+            }
+
+            void mark_stale(std::size_t k) noexcept {
+                if (std::find(stale_begin(), stale_end(), k) != stale_end())
+                    return;
+                if (_num_stale == max_stale)
+                    _layout = nullptr;
+                else
+                    _stale[_num_stale++] = k;
+            }
+
+            void set_synced(const void *layout) noexcept {
+                _layout = layout;
+                _num_stale = 0;
+            }
+
+            // Forgets the layout, e.g. when the sizes are replaced as a whole.
+            void reset() noexcept {
+                _layout = nullptr;
+                _num_stale = 0;
+            }
+
+        private:
+            const void *_layout = nullptr;
+            std::array<std::size_t, max_stale> _stale;
+            std::size_t _num_stale = 0;
+        };
+
+        // Records the components whose positions or sizes an evaluation 
+        // changes, for stateful energy functions. Kernels write positions 
+        // through writer(pos), which notes a component when the value written
+        // differs from the one it overwrites, so the cost follows the writes
+        // of the kernel (e.g. only the steps after the first changed position
+        // for engine_t::incremental). Disabled by default.
+        template<typename Index, typename Coord, typename Alloc = std::allocator<void>>
+        class MovedCellRecorder {
+        public:
+            using cell_vector_t = std::vector<Index, Alloc>;
+
+            // Position of component c written through a writer.
+            template<typename RanIt>
+            class reference {
+            public:
+                using value_type = typename std::iterator_traits<RanIt>::value_type;
+
+                reference(RanIt pos, std::size_t c, MovedCellRecorder *rec) noexcept :
+                    _pos(pos), _c(c), _rec(rec) { }
+
+                operator value_type() const {
+                    return _pos[_c];
+                }
+
+                reference &operator=(value_type value) {
+                    if (_pos[_c] != value) {
+                        _pos[_c] = value;
+                        _rec->note(_c);
+                    }
+                    return *this;
+                }
+
+                reference &operator=(const reference &other) {
+                    return *this = static_cast<value_type>(other);
+                }
+
+            private:
+                RanIt _pos;
+                std::size_t _c;
+                MovedCellRecorder *_rec;
+            };
+
+            // Positions pos[c] whose changes are noted.
+            template<typename RanIt>
+            class writer {
+            public:
+                writer(RanIt pos, MovedCellRecorder *rec) noexcept : _pos(pos), _rec(rec) { }
+
+                reference<RanIt> operator[](std::size_t c) const noexcept {
+                    return { _pos, c, _rec };
+                }
+
+            private:
+                RanIt _pos;
+                MovedCellRecorder *_rec;
+            };
+
+            bool enabled() const noexcept {
+                return _enabled;
+            }
+
+            void set_enabled(bool enabled) {
+                _enabled = enabled;
+                reset();
+            }
+
+            // Forgets the written layout, so that the next completed 
+            // evaluation reports all components.
+            void reset() {
+                _unmark();
+                _completed = false;
+                _all = true;
+            }
+
+            // Starts an evaluation of n components. Components of the last 
+            // completed one are dropped, while those noted by evaluations not
+            // completed (e.g. stopped early) are reported with this one.
+            void begin(std::size_t n) {
+                if (!_enabled)
+                    return;
+                if (_completed) {
+                    _unmark();
+                    _completed = false;
+                }
+                if (_marks.size() != n) {
+                    _marks.assign(n, 0);
+                    _cells.clear();
+                    _all = true;
+                }
+            }
+
+            // Notes that component c has been changed.
+            void note(std::size_t c) {
+                if (!_enabled || _all || _marks[c])
+                    return;
+                _marks[c] = 1;
+                _cells.push_back(static_cast<Index>(c));
+            }
+
+            // Notes that all components may have been changed.
+            void note_all() noexcept {
+                if (_enabled)
+                    _all = true;
+            }
+
+            // Completes the evaluation, whose changed components are then 
+            // given by cells().
+            void complete() {
+                if (!_enabled)
+                    return;
+                if (_all) {
+                    _unmark();
+                    for (std::size_t c = 0; c != _marks.size(); ++c)
+                        note(c);
+                }
+                _completed = true;
+            }
+
+            template<typename RanIt>
+            writer<RanIt> make_writer(RanIt pos) noexcept {
+                return { pos, this };
+            }
+
+            const cell_vector_t &cells() const noexcept {
+                return _cells;
+            }
+
+        protected:
+            void _unmark() {
+                for (auto c : _cells)
+                    _marks[c] = 0;
+                _cells.clear();
+                _all = false;
+            }
+
+            cell_vector_t _cells;
+            std::vector<char, Alloc> _marks;    // Whether each component is in _cells
+            bool _enabled = false;
+            bool _all = true;           // Whether all components are to be reported
+            bool _completed = false;    // Whether _cells are of a completed evaluation
+        };
+
         // Empty tags to identify whether I'm buffered.
         struct UnbufferedGeneratorTag { };
         struct BufferedGeneratorTag { };
@@ -103,6 +814,20 @@ namespace rect_packing {
             static constexpr size_t change_t_size =
                 static_cast<size_t>(change_t::rotate_xy) + 1;
 
+            // Enum of crossovers of sequence pairs: partially mapped, order
+            // and cycle crossover.
+            enum class crossover_t {
+                pmx, order, cycle
+            };
+
+            // Compact state of a generator, e.g. to send to other processes:
+            // the sequence pair, and whether each component is rotated 
+            // against the widths given to save and load.
+            struct snapshot_t {
+                std::vector<std::uint32_t> sp_x, sp_y;
+                std::vector<std::uint8_t> rotated;
+            };
+
             // Functor for deciding next move. Meets the concept of 
             // ChangeDistribution. Deterministic or stateful ChangeDistribution
             // can also be used for sequence pair evaluation.
@@ -210,10 +935,123 @@ namespace rect_packing {
                     return _df[static_cast<size_t>(change_t::none)] == 0;
                 }
 
+                // Probability of each change.
+                array_t probabilities() const {
+                    array_t probs;
+                    std::adjacent_difference(_df.cbegin(), _df.cend(), probs.begin());
+                    return probs;
+                }
+
             protected:
                 array_t _df;  // Distribution function
             };
 
+            // default_change_distribution that learns from the outcome of 
+            // moves. Meets the concept of AdaptiveChangeDistribution:
+            //  update(chg, accepted, gain) credits a move of chg, where gain
+            //      is the non-negative energy decrease relative to temperature;
+            //  end_temperature() reweights changes by the credits so far.
+            // Each change is credited 1 + gain per accepted move and 0 per 
+            // rejected one. At the end of each temperature the probabilities
+            // move by learning_rate towards matching the average credits, 
+            // where every change keeps a share of min_share / (number of 
+            // changes). Changes of zero prior probability are never drawn, 
+            // and the probability of none stays fixed.
+            class adaptive_change_distribution : public default_change_distribution {
+                using base_t = default_change_distribution;
+
+            public:
+                adaptive_change_distribution() : 
+                    adaptive_change_distribution(default_change_distribution()) { }
+
+                // Starts from prior.
+                explicit adaptive_change_distribution(const default_change_distribution &prior,
+                    double learning_rate = 0.3, double min_share = 0.1) :
+                    base_t(prior), learning_rate(learning_rate), min_share(min_share) {
+                    auto probs = prior.probabilities();
+                    for (std::size_t k = 0; k != change_t_size; ++k)
+                        _is_enabled[k] = k != static_cast<std::size_t>(change_t::none) &&
+                            probs[k] > 1e-9;
+                    _clear_credits();
+                }
+
+                void update(change_t chg, bool accepted, double gain) noexcept {
+                    auto k = static_cast<std::size_t>(chg);
+                    ++_tries[k];
+                    if (accepted)
+                        _credits[k] += 1 + gain;
+                }
+
+                void end_temperature() {
+                    using namespace std;
+                    const auto none = static_cast<size_t>(change_t::none);
+                    auto probs = probabilities();
+                    array_t avgs;
+                    double sum_avgs = 0, num_tried = 0, num_enabled = 0;
+                    for (size_t k = 0; k != change_t_size; ++k) {
+                        avgs[k] = _tries[k] ? _credits[k] / _tries[k] : 0;
+                        if (_is_enabled[k]) {
+                            ++num_enabled;
+                            if (_tries[k]) {
+                                sum_avgs += avgs[k];
+                                ++num_tried;
+                            }
+                        }
+                    }
+                    if (!num_tried)
+                        return;
+                    for (size_t k = 0; k != change_t_size; ++k)   // Untried ones get the mean
+                        if (_is_enabled[k] && !_tries[k])
+                            avgs[k] = sum_avgs / num_tried;
+                    sum_avgs *= num_enabled / num_tried;
+                    if (sum_avgs > 0) {
+                        const auto mass = 1 - probs[none];
+                        for (size_t k = 0; k != change_t_size; ++k) {
+                            if (!_is_enabled[k])
+                                continue;
+                            auto target = mass * (min_share / num_enabled + 
+                                (1 - min_share) * avgs[k] / sum_avgs);
+                            probs[k] += learning_rate * (target - probs[k]);
+                        }
+                        for (size_t k = 0; k != change_t_size; ++k)
+                            if (!_is_enabled[k] && k != none)
+                                probs[k] = 0;
+                        assign(probs.cbegin(), probs.cend());
+                    }
+                    _clear_credits();
+                }
+
+                double learning_rate;
+                double min_share;
+
+            protected:
+                void _clear_credits() noexcept {
+                    _credits.fill(0.0);
+                    _tries.fill(0);
+                }
+
+                std::array<bool, change_t_size> _is_enabled;
+                array_t _credits;
+                std::array<std::size_t, change_t_size> _tries;
+            };
+
+            // Name of crossover kind.
+            static const char *crossover_name(crossover_t kind) noexcept {
+                static const char *const names[] = { "pmx", "order", "cycle" };
+                return names[static_cast<std::size_t>(kind)];
+            }
+
+            // Name of chg.
+            static const char *change_name(change_t chg) noexcept {
+                static const char *const names[] = {
+                    "none", "rotate",
+                    "swap_x", "swap_y", "swap_xy",
+                    "reverse_x", "reverse_y", "reverse_xy",
+                    "rotate_x", "rotate_y", "rotate_xy"
+                };
+                return names[static_cast<std::size_t>(chg)];
+            }
+
             // Factory of default_change_distribution.
             template<typename... Types>
             static default_change_distribution 
@@ -233,6 +1071,40 @@ namespace rect_packing {
             public std::true_type { };
 #endif
 
+        // Reweighted probabilities are assigned through the base distribution.
+        template<>
+        struct IsChangeNeverNone<typename PackGeneratorBase::adaptive_change_distribution> : 
+            public IsChangeNeverNone<typename PackGeneratorBase::default_change_distribution> { };
+
+        // Traits for AdaptiveChangeDistribution concept.
+        template<typename ChgDist>
+        struct IsAdaptiveChangeDistribution : public std::false_type { };
+
+        template<>
+        struct IsAdaptiveChangeDistribution<
+            typename PackGeneratorBase::adaptive_change_distribution> : public std::true_type { };
+
+        // Crossover kind of permutations p and q of [0, n) into child, as 
+        // above. taken holds n flags, all false.
+        template<typename RanIt0, typename RanIt1, typename RanIt2, typename RanIt3,
+            typename Flags>
+        void crossover_permutations(PackGeneratorBase::crossover_t kind, RanIt0 p,
+            RanIt1 inv_p, RanIt2 q, std::size_t n, std::size_t i, std::size_t j,
+            RanIt3 child, Flags &taken) {
+            using crossover_t = PackGeneratorBase::crossover_t;
+            switch (kind) {
+            case crossover_t::pmx:
+                pmx_crossover(p, inv_p, q, n, i, j, child);
+                break;
+            case crossover_t::order:
+                order_crossover(p, inv_p, q, n, i, j, child);
+                break;
+            default:
+                cycle_crossover(p, inv_p, q, n, child, taken);
+                break;
+            }
+        }
+
         template<typename ChgDist>
         bool may_change_be_none(ChgDist &&chg_dist) {
             return may_change_be_none_impl(std::forward<ChgDist>(chg_dist), 
@@ -250,22 +1122,31 @@ namespace rect_packing {
         }
 
         // Graph-based sequence-pair packing generator which does not own buffer resource.
-        template<typename Alloc = std::allocator<void>>
+        // Index is the unsigned type of sequence pairs, which must hold [0, n), and 
+        // Coord is the coordinate type of layouts, which must hold the packing.
+        template<typename Alloc = std::allocator<void>, typename Index = std::size_t,
+            typename Coord = int>
         class DagPackGeneratorBase : public PackGeneratorBase {
-            using self_t = DagPackGeneratorBase<Alloc>;
+            using self_t = DagPackGeneratorBase<Alloc, Index, Coord>;
             using base_t = PackGeneratorBase;
+            static_assert(std::is_unsigned<Index>::value, "Index must be unsigned");
 
         protected:
-            using size_vector_t = std::vector<int, Alloc>;
-            using sequence_pair_t = std::vector<std::size_t, Alloc>;
+            using size_vector_t = std::vector<Coord, Alloc>;
+            using sequence_pair_t = std::vector<Index, Alloc>;
             using momento_t = std::tuple<change_t, std::size_t, std::size_t>;
 
         public:
             using typename base_t::change_t;
+            using typename base_t::crossover_t;
+            using typename base_t::snapshot_t;
             using typename base_t::default_change_distribution;
             using allocator_type = Alloc;
+            using index_type = Index;
+            using coordinate_type = Coord;
             using resource_t = std::vector<char, allocator_type>;
             using generator_tag = UnbufferedGeneratorTag;
+            using change_record_t = momento_t;  // (change, i, j)
             
             DagPackGeneratorBase() : DagPackGeneratorBase(allocator_type()) { }
 
@@ -274,7 +1155,7 @@ namespace rect_packing {
 
             explicit DagPackGeneratorBase(const allocator_type &alloc) : 
                 _widths(alloc), _heights(alloc), _sp_x(alloc), _sp_y(alloc),
-                _last_change(change_t::none, 0, 0) { }
+                _inv_x(alloc), _inv_y(alloc), _last_change(change_t::none, 0, 0) { }
 
             template<typename Cont0, typename Cont1, typename Eng>
                 DagPackGeneratorBase(Cont0 &&widths, Cont1 &&heights,
@@ -284,6 +1165,7 @@ namespace rect_packing {
                 _heights(std::begin(std::forward<Cont1>(heights)),
                     std::end(std::forward<Cont1>(heights)), alloc),
                 _sp_x(this->_size(), alloc), _sp_y(this->_size(), alloc),
+                _inv_x(this->_size(), alloc), _inv_y(this->_size(), alloc),
                 _last_change(change_t::none, 0, 0) {
                 assert(_widths.size() == _heights.size());
                 std::iota(_sp_x.begin(), _sp_x.end(), 0);
@@ -328,15 +1210,10 @@ namespace rect_packing {
             // Returns: (width, height)
             template<typename LayoutAlloc, typename Eng,
                 typename ChgDist = default_change_distribution>
-                std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+                std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
                     Eng &&eng, resource_t &res, ChgDist &&chg_dist = ChgDist()) {
-                assert(layout.size() == this->_size());
-                // Change to next state, widths and heights may change
-                _change(std::forward<Eng>(eng), std::forward<ChgDist>(chg_dist));
-                // Synchronize widths and heights
-                _unguarded_copy_layout_sizes(layout);
-                // Evaluate current state
-                return _eval(layout, std::forward<Eng>(eng), res);
+                return this->operator()(layout, std::forward<Eng>(eng), res,
+                    std::forward<ChgDist>(chg_dist), allocator_type());
             }
 
             // Computes packing layout, writes result to layout, and changes
@@ -344,10 +1221,26 @@ namespace rect_packing {
             // Arg alloc is ignored. This is for consistency with LcsPackGeneratorBase.
             // Returns: (width, height, wire-length)
             template<typename LayoutAlloc, typename Eng, typename ChgDist, typename OtherAlloc>
-            std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+            std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
                 Eng &&eng, resource_t &res, ChgDist &&chg_dist, OtherAlloc &&alloc) {
                 return this->operator()(layout, std::forward<Eng>(eng), res,
-                    std::forward<ChgDist>(chg_dist));
+                    std::forward<ChgDist>(chg_dist), std::forward<OtherAlloc>(alloc),
+                    std::numeric_limits<Coord>::max());
+            }
+
+            // As above, but the evaluation may stop once the width reaches 
+            // reject_width, e.g. when such a packing would be rejected anyway.
+            // Then the height and y positions are unspecified, and 
+            // moved_cells() is not updated. The move can be rolled back as usual.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename ChgDist, typename OtherAlloc>
+            std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
+                Eng &&eng, resource_t &res, ChgDist &&chg_dist, OtherAlloc &&,
+                Coord reject_width) {
+                assert(layout.size() == this->_size());
+                // Change to next state, widths and heights may change
+                _change(std::forward<Eng>(eng), std::forward<ChgDist>(chg_dist));
+                return _sync_and_eval(layout, res, reject_width);
             }
 
             // One-shot rollback. If cannot rollback, does nothing.
@@ -396,39 +1289,203 @@ namespace rect_packing {
                 return ans;
             }
 
-            // Random shuffle. This invalidates the subsequent call to rollback.
-            template<typename Eng>
-            void shuffle(Eng &&eng, double p_rotate = 0.5) {
-                using namespace std;
-                bernoulli_distribution rand_bool(p_rotate);
-                for (size_t i = 0; i != this->_size(); ++i)
-                    if (rand_bool(eng))
-                        swap(_widths[i], _heights[i]);
-                std::shuffle(_sp_x.begin(), _sp_x.end(), eng);
-                std::shuffle(_sp_y.begin(), _sp_y.end(), eng);
-                _last_change = forward_as_tuple(change_t::none, 0, 0);
+            // The last move, whose change is none if it has been rolled back.
+            const change_record_t &last_change() const noexcept {
+                return _last_change;
             }
 
-            auto size() const noexcept {
-                return this->_size();
-            }
+            // Applies a move given by last_change() again, e.g. to replay the
+            // moves of a generator on a copy of its earlier state. This 
+            // invalidates the subsequent call to rollback.
+            void redo(const change_record_t &rec) {
+                change_t chg; size_t i, j;
+                std::tie(chg, i, j) = rec;
 
-            auto empty() const noexcept {
-                return _widths.empty();
-            }
+                switch (chg) {
+                case change_t::none:
+                    break;
 
-            friend std::ostream &operator<<(std::ostream &out, const self_t &gen) {
-                return gen._print(out);
-            }
+                case change_t::rotate:
+                    _unrotate_component(i);
+                    break;
 
-            template<typename Alloc0, typename Alloc1>
-            friend void unguarded_copy_unbuffered_generator(const DagPackGeneratorBase<Alloc0> &src,
-                DagPackGeneratorBase<Alloc1> &dest);
+                case change_t::swap_x:
+                case change_t::swap_y:
+                case change_t::swap_xy:
+                    _unswap_sp(i, j, chg);
+                    break;
+
+                case change_t::reverse_x:
+                case change_t::reverse_y:
+                case change_t::reverse_xy:
+                    _unreverse_sp(i, j, chg);
+                    break;
+
+                case change_t::rotate_x:
+                case change_t::rotate_y:
+                case change_t::rotate_xy:
+                    _do_rotate_sp(i, j, chg);
+                    break;
+
+                default:
+                    assert(("no match for switch", false));
+                }
+
+                std::get<0>(_last_change) = change_t::none;
+            }
+
+            // Applies rec as above, and evaluates the state as operator(...)
+            // does, e.g. to follow a move accepted by another generator. 
+            // Unlike pack(...), moved_cells() then gives the components moved
+            // since the last evaluation into layout.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
+            std::pair<Coord, Coord> redo(const change_record_t &rec, 
+                Layout<LayoutAlloc, Coord> &layout, Eng &&, resource_t &res, OtherAlloc &&) {
+                assert(layout.size() == this->_size());
+                redo(rec);
+                return _sync_and_eval(layout, res, std::numeric_limits<Coord>::max());
+            }
+
+            // Computes packing layout of the current state without moving, 
+            // e.g. to materialize a state kept by its sequence pair only.
+            // Evaluates from scratch, so the next evaluation reports all 
+            // components as moved.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
+            std::pair<Coord, Coord> pack(Layout<LayoutAlloc, Coord> &layout,
+                Eng &&, resource_t &res, OtherAlloc &&) {
+                assert(layout.size() == this->_size());
+                ++_revision;
+                _unguarded_copy_layout_sizes(layout);
+                _size_sync.set_synced(std::addressof(layout));
+                _moved.reset();
+                return _eval(layout, layout.x_begin(), layout.y_begin(), res);
+            }
+
+            // Random shuffle. This invalidates the subsequent call to rollback.
+            template<typename Eng>
+            void shuffle(Eng &&eng, double p_rotate = 0.5) {
+                using namespace std;
+                bernoulli_distribution rand_bool(p_rotate);
+                for (size_t i = 0; i != this->_size(); ++i)
+                    if (rand_bool(eng))
+                        swap(_widths[i], _heights[i]);
+                std::shuffle(_sp_x.begin(), _sp_x.end(), eng);
+                std::shuffle(_sp_y.begin(), _sp_y.end(), eng);
+                _make_inverses();
+                _last_change = forward_as_tuple(change_t::none, 0, 0);
+                ++_revision;
+                _size_sync.reset();
+            }
+
+            // Makes this the child of lhs and rhs, generators of the same 
+            // components, by crossover kind of both sequences with a common
+            // random segment kept from lhs. Each component is oriented as in 
+            // the parent whose position of it in the x sequence the child 
+            // keeps, lhs if both. Requires: this is neither lhs nor rhs. This
+            // invalidates the subsequent call to rollback.
+            template<typename Eng>
+            void crossover(const self_t &lhs, const self_t &rhs, crossover_t kind, Eng &&eng) {
+                using namespace std;
+                assert(lhs._size() == _size() && rhs._size() == _size());
+                assert(this != addressof(lhs) && this != addressof(rhs));
+                auto n = _size();
+                size_t i = 0, j = n;
+                if (n >= 2)
+                    tie(i, j) = detail::random_long_range(eng, n);
+                vector<bool> taken(n);
+                detail::crossover_permutations(kind, lhs._sp_x.data(), lhs._inv_x.data(),
+                    rhs._sp_x.data(), n, i, j, _sp_x.data(), taken);
+                taken.assign(n, false);
+                detail::crossover_permutations(kind, lhs._sp_y.data(), lhs._inv_y.data(),
+                    rhs._sp_y.data(), n, i, j, _sp_y.data(), taken);
+                for (size_t k = 0; k != n; ++k) {
+                    auto c = _sp_x[k];
+                    const auto &parent = lhs._sp_x[k] == c ? lhs : rhs;
+                    _widths[c] = parent._widths[c];
+                    _heights[c] = parent._heights[c];
+                }
+                _make_inverses();
+                _last_change = forward_as_tuple(change_t::none, 0, 0);
+                ++_revision;
+                _size_sync.reset();
+            }
+
+            // Writes the state to snap, with orientations against widths.
+            template<typename Cont>
+            void save(snapshot_t &snap, const Cont &widths) const {
+                auto n = _size();
+                snap.sp_x.assign(_sp_x.begin(), _sp_x.end());
+                snap.sp_y.assign(_sp_y.begin(), _sp_y.end());
+                snap.rotated.resize(n);
+                auto it = std::begin(widths);
+                for (std::size_t c = 0; c != n; ++c, ++it)
+                    snap.rotated[c] = _widths[c] != *it;
+            }
+
+            // Restores the state saved by a generator of the same components
+            // of widths and heights. This invalidates the subsequent call to
+            // rollback.
+            template<typename Cont0, typename Cont1>
+            void load(const snapshot_t &snap, const Cont0 &widths, const Cont1 &heights) {
+                using namespace std;
+                auto n = _size();
+                assert(snap.sp_x.size() == n && snap.sp_y.size() == n && 
+                    snap.rotated.size() == n);
+                copy(snap.sp_x.cbegin(), snap.sp_x.cend(), _sp_x.begin());
+                copy(snap.sp_y.cbegin(), snap.sp_y.cend(), _sp_y.begin());
+                auto w = begin(widths);
+                auto h = begin(heights);
+                for (size_t c = 0; c != n; ++c, ++w, ++h) {
+                    _widths[c] = static_cast<Coord>(snap.rotated[c] ? *h : *w);
+                    _heights[c] = static_cast<Coord>(snap.rotated[c] ? *w : *h);
+                }
+                _make_inverses();
+                _last_change = forward_as_tuple(change_t::none, 0, 0);
+                ++_revision;
+                _size_sync.reset();
+            }
+
+            auto size() const noexcept {
+                return this->_size();
+            }
+
+            auto empty() const noexcept {
+                return _widths.empty();
+            }
+
+            // Enables moved_cells(), which costs a comparison per position 
+            // written by an evaluation.
+            void set_tracks_moved_cells(bool enabled) {
+                _moved.set_enabled(enabled);
+            }
+
+            // Makes the next evaluation report all components as moved, e.g.
+            // after the layout has been replaced.
+            void reset_moved_cells() {
+                _moved.reset();
+            }
+
+            // Components whose positions or sizes were changed by the last
+            // evaluation in the layout it wrote to, if tracked.
+            const auto &moved_cells() const noexcept {
+                return _moved.cells();
+            }
+
+            friend std::ostream &operator<<(std::ostream &out, const self_t &gen) {
+                return gen._print(out);
+            }
+
+            template<typename Alloc0, typename Alloc1, typename Index1, typename Coord1>
+            friend void unguarded_copy_unbuffered_generator(
+                const DagPackGeneratorBase<Alloc0, Index1, Coord1> &src,
+                DagPackGeneratorBase<Alloc1, Index1, Coord1> &dest);
 
         protected:
 
             template<typename LayoutAlloc>
-            void _unguarded_copy_layout_sizes(Layout<LayoutAlloc> &layout) const {
+            void _unguarded_copy_layout_sizes(Layout<LayoutAlloc, Coord> &layout) const {
                 assert(layout.size() == this->_size());
                 auto sz = this->_size();
                 std::copy(_widths.data(), _widths.data() + sz, 
@@ -437,98 +1494,113 @@ namespace rect_packing {
                     addressof(*layout.heights_begin()));
             }
 
+            // Synchronizes widths and heights of layout, which copies only the
+            // rotated components if layout is the one synchronized last time.
+            template<typename LayoutAlloc>
+            void _sync_layout_sizes(Layout<LayoutAlloc, Coord> &layout) {
+                if (!_size_sync.is_synced(std::addressof(layout))) {
+                    _unguarded_copy_layout_sizes(layout);
+                    _moved.note_all();
+                } else {
+                    for (auto it = _size_sync.stale_begin(); it != _size_sync.stale_end(); ++it) {
+                        layout.widths_begin()[*it] = _widths[*it];
+                        layout.heights_begin()[*it] = _heights[*it];
+                        _moved.note(*it);
+                    }
+                }
+                _size_sync.set_synced(std::addressof(layout));
+            }
+
+            // Implements operator(...) after the change: synchronizes sizes 
+            // and evaluates the state, noting moved cells if tracked.
+            template<typename LayoutAlloc>
+            std::pair<Coord, Coord> _sync_and_eval(Layout<LayoutAlloc, Coord> &layout,
+                resource_t &res, Coord reject_width) {
+                _moved.begin(_size());
+                _sync_layout_sizes(layout);
+                auto area = _moved.enabled() ?
+                    _eval(layout, _moved.make_writer(layout.x_begin()), 
+                        _moved.make_writer(layout.y_begin()), res, reject_width) :
+                    _eval(layout, layout.x_begin(), layout.y_begin(), res, reject_width);
+                if (area.first < reject_width)
+                    _moved.complete();
+                return area;
+            }
+
             template<typename Alloc1>
-            void _unguarded_assign(const DagPackGeneratorBase<Alloc1> &src) {
+            void _unguarded_assign(const DagPackGeneratorBase<Alloc1, Index, Coord> &src) {
                 using namespace std;
                 assert(_size() == src._size());
                 auto sz = _size();
                 copy(src._sp_x.data(), src._sp_x.data() + sz, _sp_x.data());
                 copy(src._sp_y.data(), src._sp_y.data() + sz, _sp_y.data());
+                copy(src._inv_x.data(), src._inv_x.data() + sz, _inv_x.data());
+                copy(src._inv_y.data(), src._inv_y.data() + sz, _inv_y.data());
                 copy(src._widths.data(), src._widths.data() + sz, _widths.data());
                 copy(src._heights.data(), src._heights.data() + sz, _heights.data());
                 _last_change = src._last_change;
+                ++_revision;
+                _size_sync.reset();
             }
 
-            // Implements the evaluation stage of operator(...). 
+            // Implements the evaluation stage of operator(...), writing the
+            // positions of layout to x_pos and y_pos once per component.
             // Requires: widths and heights between this object and layout have
             //      been synchronized.
-            template<typename LayoutAlloc, typename Eng>
-            std::pair<int, int> _eval(Layout<LayoutAlloc> &layout,
-                Eng &&eng, resource_t &res) {
+            template<typename LayoutAlloc, typename XPos, typename YPos>
+            std::pair<Coord, Coord> _eval(Layout<LayoutAlloc, Coord> &layout,
+                XPos x_pos, YPos y_pos, resource_t &res, 
+                Coord reject_width = std::numeric_limits<Coord>::max()) {
                 using namespace std;
-                using namespace boost;
-                using graph_t = adjacency_list<vecS, vecS, directedS,
-                    property<vertex_distance_t, int>,
-                    property<edge_weight_t, int>>;
-
                 if (layout.empty())
                     return { 0, 0 };
+
+                // The constraint graphs live in res after the path lengths: 
+                // offsets of the horizontal and vertical graphs, followed by 
+                // their edges.
+                const auto sz = _size();
+                const auto dist_size = _dist_size();
+                const auto fixed_size = dist_size + 2 * sz + 2;
+                Coord *dist;
+                size_t *h_offsets, *v_offsets, *adj;
                 auto min_buffer_size = _min_buffer_size();
                 if (res.size() < min_buffer_size)
                     res.resize(min_buffer_size);
-                auto mem_src = res.data();
-
-                // Build position maps
-                auto sx = reinterpret_cast<size_t *>(mem_src);
-                mem_src += _size() * sizeof(size_t);
-                auto sy = reinterpret_cast<size_t *>(mem_src);
-                mem_src += _size() * sizeof(size_t);
-                detail::make_left_inverse(_sp_x.cbegin(), _sp_x.cend(), sx);
-                detail::make_left_inverse(_sp_y.cbegin(), _sp_y.cend(), sy);
-
-                const auto num_nodes = _size() + 2;
-                const auto src = _size();
-                const auto target = _size() + 1;
-                graph_t hg(num_nodes), vg(num_nodes);
-                std::array<graph_t *, 2> graphs{ std::addressof(hg),
-                    std::addressof(vg) };
-
-                // Add the edges, note that weights are moved to out-edge.
-                for (auto g : graphs)
-                    for (size_t i = 0; i != _size(); ++i)
-                        add_edge(src, i, 0, *g);
-                for (size_t i = 0; i != _size(); ++i)
-                    add_edge(i, target, -_widths[i], hg);
-                for (size_t i = 0; i != _size(); ++i)
-                    add_edge(i, target, -_heights[i], vg);
-
-                // Now directly add the horizontal constraint pairs and vertical 
-                // constraint pairs to hg and vg.
-                for (size_t i = 0; i < _size(); ++i) {
-                    for (size_t j = 0; j < _size(); ++j) {
-                        if (/*i != j && */sy[i] < sy[j]) {
-                            if (sx[i] < sx[j]) {
-                                // bb->left: i is to the left of j
-                                add_edge(i, j, -_widths[i], hg);
-                            } else {
-                                // ab->below: i is below j
-                                assert(sx[i] > sx[j]);
-                                add_edge(i, j, -_heights[i], vg);
-                            }
-                        }
-                    }
-                }
-
-                // Packing by the longest path algorithm
-                std::array<int, 2> sizes;    // w, h
-                std::array<decltype(layout.x_begin()), 2> dests{ layout.x_begin(),
-                    layout.y_begin() };
-
-                for (int i = 0; i != 2; ++i) {
-                    auto &g = *graphs[i];
-                    auto dest = dests[i];
-                    property_map<graph_t, vertex_distance_t>::type
-                        d_map = get(vertex_distance, g);
-                    dag_shortest_paths(g, src, distance_map(d_map));
-                    graph_traits<graph_t>::vertex_iterator vi, vi_end;
-                    for (boost::tie(vi, vi_end) = vertices(g); vi != vi_end; ++vi)
-                        if (*vi != src && *vi != target)
-                            *dest++ = -d_map[*vi];
-                    sizes[i] = -d_map[target];
+                for (;;) {
+                    dist = reinterpret_cast<Coord *>(res.data());
+                    h_offsets = reinterpret_cast<size_t *>(res.data()) + dist_size;
+                    v_offsets = h_offsets + sz + 1;
+                    adj = v_offsets + sz + 1;
+                    auto capacity = res.size() / sizeof(size_t) - fixed_size;
+
+                    // Build the transitively reduced graphs
+                    auto num_h_edges = detail::make_reduced_constraint_graph(
+                        _sp_x.cbegin(), _inv_x.cbegin(), _inv_y.cbegin(), sz, false, 
+                        h_offsets, adj, capacity);
+                    auto h_used = min(num_h_edges, capacity);
+                    auto num_v_edges = detail::make_reduced_constraint_graph(
+                        _sp_x.cbegin(), _inv_x.cbegin(), _inv_y.cbegin(), sz, true, 
+                        v_offsets, adj + h_used, capacity - h_used);
+                    for (size_t i = 0; i <= sz; ++i)
+                        v_offsets[i] += h_used;
+                    if (num_h_edges + num_v_edges <= capacity)
+                        break;
+                    // Rarely happens once the resource has grown
+                    res.resize((fixed_size + 2 * (num_h_edges + num_v_edges)) * 
+                        sizeof(size_t));
                 }
 
-                assert(make_pair(sizes[0], sizes[1]) == layout.get_area());
-                return { sizes[0], sizes[1] };
+                // Packing by the longest path algorithm. Left-of edges follow 
+                // the order of x, and below edges follow the order of y.
+                auto w = detail::eval_longest_paths(_sp_x.cbegin(), _sp_x.cend(),
+                    h_offsets, adj, _widths.cbegin(), dist, x_pos);
+                if (w >= reject_width)
+                    return { w, 0 };
+                auto h = detail::eval_longest_paths(_sp_y.cbegin(), _sp_y.cend(),
+                    v_offsets, adj, _heights.cbegin(), dist, y_pos);
+
+                assert(make_pair(w, h) == layout.get_area());
+                return { w, h };
             }
 
             template<typename Eng, typename ChgDist>
@@ -573,86 +1645,103 @@ namespace rect_packing {
             template<typename Eng>
             void _swap_sp(Eng &&eng, change_t chg) {
                 using namespace std;
-                uniform_int_distribution<size_t> rand_size_t(0, _size() - 1);
-                size_t i = 0, j = 0;
-                while (i == j) {
-                    i = rand_size_t(std::forward<Eng>(eng));
-                    j = rand_size_t(std::forward<Eng>(eng));
-                }
-
+                size_t i, j;
+                tie(i, j) = detail::random_distinct_pair(eng, _size());
                 _unswap_sp(i, j, chg);
                 _last_change = forward_as_tuple(chg, i, j);
             }
 
             void _unswap_sp(size_t i, size_t j, change_t chg) {
-                if (chg == change_t::swap_x || chg == change_t::swap_xy)
+                if (chg == change_t::swap_x || chg == change_t::swap_xy) {
                     swap(_sp_x[i], _sp_x[j]);
-                if (chg == change_t::swap_y || chg == change_t::swap_xy)
+                    _inv_x[_sp_x[i]] = static_cast<Index>(i);
+                    _inv_x[_sp_x[j]] = static_cast<Index>(j);
+                }
+                if (chg == change_t::swap_y || chg == change_t::swap_xy) {
                     swap(_sp_y[i], _sp_y[j]);
+                    _inv_y[_sp_y[i]] = static_cast<Index>(i);
+                    _inv_y[_sp_y[j]] = static_cast<Index>(j);
+                }
             }
 
             template<typename Eng>
             void _rotate_sp(Eng &&eng, change_t chg) {
                 using namespace std;
                 assert(!empty());
-                uniform_int_distribution<std::size_t> rand_size_t(0, _size());
-                size_t i = 0, j = 0;
-                while (j <= i + 1) {
-                    i = rand_size_t(std::forward<Eng>(eng));
-                    j = rand_size_t(std::forward<Eng>(eng));
-                    if (i > j)
-                        swap(i, j);
-                }
-                
-                if (chg == change_t::rotate_x || chg == change_t::rotate_xy)
-                    rotate(_sp_x.data() + i, _sp_x.data() + i + 1, _sp_x.data() + j);
-                if (chg == change_t::rotate_y || chg == change_t::rotate_xy)
-                    rotate(_sp_y.data() + i, _sp_y.data() + i + 1, _sp_y.data() + j);
-
+                size_t i, j;
+                tie(i, j) = detail::random_long_range(eng, _size());
+                _do_rotate_sp(i, j, chg);
                 _last_change = forward_as_tuple(chg, i, j);
             }
 
+            void _do_rotate_sp(size_t i, size_t j, change_t chg) {
+                if (chg == change_t::rotate_x || chg == change_t::rotate_xy) {
+                    std::rotate(_sp_x.data() + i, _sp_x.data() + i + 1, _sp_x.data() + j);
+                    _update_inverse(_sp_x, _inv_x, i, j);
+                }
+                if (chg == change_t::rotate_y || chg == change_t::rotate_xy) {
+                    std::rotate(_sp_y.data() + i, _sp_y.data() + i + 1, _sp_y.data() + j);
+                    _update_inverse(_sp_y, _inv_y, i, j);
+                }
+            }
+
             void _unrotate_sp(size_t i, size_t j, change_t chg) {
-                if (chg == change_t::rotate_x || chg == change_t::rotate_xy)
+                if (chg == change_t::rotate_x || chg == change_t::rotate_xy) {
                     std::rotate(_sp_x.data() + i, _sp_x.data() + j - 1, _sp_x.data() + j);
-                if (chg == change_t::rotate_y || chg == change_t::rotate_xy)
+                    _update_inverse(_sp_x, _inv_x, i, j);
+                }
+                if (chg == change_t::rotate_y || chg == change_t::rotate_xy) {
                     std::rotate(_sp_y.data() + i, _sp_y.data() + j - 1, _sp_y.data() + j);
+                    _update_inverse(_sp_y, _inv_y, i, j);
+                }
             }
 
             template<typename Eng>
             void _reverse_sp(Eng &&eng, change_t chg) {
                 using namespace std;
-                uniform_int_distribution<size_t> rand_size_t(0, _size());
-                size_t i = 0, j = 0;
-                while (j <= i + 1) {
-                    i = rand_size_t(std::forward<Eng>(eng));
-                    j = rand_size_t(std::forward<Eng>(eng));
-                    if (i > j)
-                        swap(i, j);
-                }
-
+                size_t i, j;
+                tie(i, j) = detail::random_long_range(eng, _size());
                 _unreverse_sp(i, j, chg);
                 _last_change = forward_as_tuple(chg, i, j);
             }
 
             void _unreverse_sp(size_t i, size_t j, change_t chg) {
-                if (chg == change_t::reverse_x || chg == change_t::reverse_xy)
+                if (chg == change_t::reverse_x || chg == change_t::reverse_xy) {
                     reverse(_sp_x.data() + i, _sp_x.data() + j);
-                if (chg == change_t::reverse_y || chg == change_t::reverse_xy)
+                    _update_inverse(_sp_x, _inv_x, i, j);
+                }
+                if (chg == change_t::reverse_y || chg == change_t::reverse_xy) {
                     reverse(_sp_y.data() + i, _sp_y.data() + j);
+                    _update_inverse(_sp_y, _inv_y, i, j);
+                }
+            }
+
+            // Rebuilds inverses of the sequence pair from scratch.
+            void _make_inverses() {
+                _inv_x.resize(_size());
+                _inv_y.resize(_size());
+                detail::make_left_inverse(_sp_x.cbegin(), _sp_x.cend(), _inv_x.begin());
+                detail::make_left_inverse(_sp_y.cbegin(), _sp_y.cend(), _inv_y.begin());
+            }
+
+            // Refreshes inv after sp has been permuted within [i, j).
+            static void _update_inverse(const sequence_pair_t &sp, sequence_pair_t &inv,
+                std::size_t i, std::size_t j) {
+                for (; i != j; ++i)
+                    inv[sp[i]] = static_cast<Index>(i);
             }
 
             template<typename Eng>
             void _rotate_component(Eng &&eng, change_t chg) {
                 using namespace std;
-                auto k = uniform_int_distribution<std::size_t>(0, _size() - 1)(
-                    std::forward<Eng>(eng));
+                auto k = detail::bounded_random(eng, _size());
                 _unrotate_component(k);
                 _last_change = forward_as_tuple(chg, k, k);
             }
 
             void _unrotate_component(size_t k) {
                 swap(_widths[k], _heights[k]);
+                _size_sync.mark_stale(k);
             }
 
             std::ostream &_print(std::ostream &out) const {
@@ -665,22 +1754,41 @@ namespace rect_packing {
                 return _widths.size();
             }
 
-            // Determines size of resource_t in bytes, which is the sum of 
-            // variables sx and sy. Computing wirelength can reuse the buffer.
+            // Number of size_t words holding the path lengths in resource_t.
+            auto _dist_size() const noexcept {
+                return (_size() * sizeof(Coord) + sizeof(std::size_t) - 1) / 
+                    sizeof(std::size_t);
+            }
+
+            // Determines size of resource_t in bytes: path lengths, offsets of 
+            // both constraint graphs, and an initial guess of their edges, which
+            // is O(nlogn) for random sequence pairs. Computing wirelength can 
+            // reuse the buffer.
             auto _min_buffer_size() const noexcept {
-                return 2 * _size() * sizeof(std::size_t);
+                std::size_t log_size = 1;
+                while ((std::size_t(1) << log_size) <= _size())
+                    ++log_size;
+                return (_dist_size() + 2 * _size() + 2 + 2 * _size() * log_size) * 
+                    sizeof(std::size_t);
             }
 
             size_vector_t _widths, _heights;    // Copies of component sizes
             sequence_pair_t _sp_x, _sp_y;
+            sequence_pair_t _inv_x, _inv_y;     // Kept in sync by every move
             momento_t _last_change;   // One-shot info of last change 
+            // Bumped whenever the state is replaced as a whole rather than
+            // changed by a move, which invalidates incremental evaluation.
+            std::size_t _revision = 0;
+            MovedCellRecorder<Index, Coord, Alloc> _moved;
+            LayoutSizeSync _size_sync;
         };
 
         // LCS-based sequence-pair packing generator which does not own buffer resource.
-        template<typename Alloc = std::allocator<void> >
-        class LcsPackGeneratorBase : public DagPackGeneratorBase<Alloc> {
-            using self_t = LcsPackGeneratorBase<Alloc>;
-            using base_t = DagPackGeneratorBase<Alloc>;
+        template<typename Alloc = std::allocator<void>, typename Index = std::size_t,
+            typename Coord = int>
+        class LcsPackGeneratorBase : public DagPackGeneratorBase<Alloc, Index, Coord> {
+            using self_t = LcsPackGeneratorBase<Alloc, Index, Coord>;
+            using base_t = DagPackGeneratorBase<Alloc, Index, Coord>;
 
         protected:
             using typename base_t::size_vector_t;
@@ -691,18 +1799,49 @@ namespace rect_packing {
             using typename base_t::allocator_type;
             using typename base_t::resource_t;
             using typename base_t::change_t;
+            using typename base_t::crossover_t;
+            using typename base_t::snapshot_t;
             using typename base_t::default_change_distribution;
+            using typename base_t::index_type;
+            using typename base_t::coordinate_type;
+            using typename base_t::change_record_t;
             using generator_tag = UnbufferedGeneratorTag;
 
             using base_t::DagPackGeneratorBase;
 
+            // Evaluation backend of the weighted LCS. All engines give identical
+            // positions.
+            enum class engine_t { 
+                map,        // Node-based staircase, O(nlogn). Reference version.
+                fenwick,    // Flat Fenwick tree of prefix maximums, O(nlogn)
+                veb,        // van Emde Boas staircase, O(nloglogn)
+                incremental,// Fenwick tree with per-step checkpoints, only 
+                            // steps after the first changed one are evaluated
+                simd,       // Vectorized masked maximums, O(n^2 / lanes). Runs
+                            // as fenwick if Coord is wider than 32 bits.
+                automatic   // simd up to simd_max_size components, otherwise 
+                            // fenwick
+            };
+
+            // Largest instance evaluated by engine_t::simd under engine_t::automatic.
+            static constexpr std::size_t simd_max_size = detail::simd_max_size;
+
+            // Makes a resource object that can be shared.  
+            resource_t make_resource() const {
+                return resource_t(_min_buffer_size());
+            }
+
+            resource_t make_resource(const allocator_type &alloc) const {
+                return resource_t(_min_buffer_size(), alloc);
+            }
+
             // Computes packing layout, writes result to layout, and changes
             // next internal state.
             // Note: uses allocator_type to construct map.
             // Returns: (width, height, wire-length)
             template<typename LayoutAlloc, typename Eng, 
                 typename ChgDist = default_change_distribution>
-            std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+            std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
                 Eng &&eng, resource_t &res, ChgDist &&chg_dist = ChgDist()) {
                 return this->operator()(layout, std::forward<Eng>(eng), res,
                     std::forward<ChgDist>(chg_dist), allocator_type());
@@ -714,44 +1853,221 @@ namespace rect_packing {
             // Returns: (width, height, wire-length)
             template<typename LayoutAlloc, typename Eng, typename ChgDist, 
                 typename OtherAlloc>
-            std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+            std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
                 Eng &&eng, resource_t &res, ChgDist &&chg_dist, OtherAlloc &&alloc) {
-                // Change to next state and synchronize widths and heights
+                return this->operator()(layout, std::forward<Eng>(eng), res,
+                    std::forward<ChgDist>(chg_dist), std::forward<OtherAlloc>(alloc),
+                    std::numeric_limits<Coord>::max());
+            }
+
+            // As above, but the evaluation may stop once the width reaches 
+            // reject_width, as DagPackGeneratorBase does. Fused engines stop
+            // within the pass, others skip the y pass.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename ChgDist, 
+                typename OtherAlloc>
+            std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
+                Eng &&eng, resource_t &res, ChgDist &&chg_dist, OtherAlloc &&alloc,
+                Coord reject_width) {
+                // Change to next state, then synchronize and evaluate
                 this->_change(std::forward<Eng>(eng), std::forward<ChgDist>(chg_dist));
+                return _sync_and_eval(layout, res, std::forward<OtherAlloc>(alloc), 
+                    reject_width);
+            }
+
+            using base_t::redo;
+
+            // Applies rec and evaluates the state as DagPackGeneratorBase does.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
+            std::pair<Coord, Coord> redo(const change_record_t &rec, 
+                Layout<LayoutAlloc, Coord> &layout, Eng &&, resource_t &res, 
+                OtherAlloc &&alloc) {
+                assert(layout.size() == this->_size());
+                redo(rec);
+                return _sync_and_eval(layout, res, std::forward<OtherAlloc>(alloc),
+                    std::numeric_limits<Coord>::max());
+            }
+
+            // Computes packing layout of the current state without moving, as
+            // DagPackGeneratorBase does.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
+            std::pair<Coord, Coord> pack(Layout<LayoutAlloc, Coord> &layout,
+                Eng &&, resource_t &res, OtherAlloc &&alloc) {
+                assert(layout.size() == this->_size());
+                ++this->_revision;  // Positions of the last evaluation are not kept
                 this->_unguarded_copy_layout_sizes(layout);
-                // Evaluate changed state
-                return _eval(layout, eng, res, std::forward<OtherAlloc>(alloc));
+                this->_size_sync.set_synced(std::addressof(layout));
+                this->_moved.reset();
+                return _eval(layout, layout.x_begin(), layout.y_begin(), res, 
+                    std::forward<OtherAlloc>(alloc));
+            }
+
+            engine_t engine() const noexcept {
+                return _engine;
+            }
+
+            // Selects evaluation backend. Resource made before may be enlarged
+            // on the next evaluation.
+            // Note: engine_t::incremental requires that each evaluation writes 
+            //      to the layout written by the previous one (as SaPacker does),
+            //      since positions before the first changed step are kept. 
+            //      Rollback costs nothing extra: the next evaluation restarts
+            //      from the first step that differs from the last evaluation.
+            void set_engine(engine_t engine) noexcept {
+                _engine = engine;
+                for (auto &cp : _checkpoints)
+                    cp.steps.clear();
             }
         
         protected:
-            // Implements the evaluation stage of operator(...).
-            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
-            std::pair<int, int> _eval(Layout<LayoutAlloc> &layout,
-                Eng &&eng, resource_t &res, OtherAlloc &&alloc) {
+            // Checkpoints of one dimension for engine_t::incremental. The 
+            // Fenwick tree is kept after the last step, together with a journal
+            // of the cells each step overwrote, so the tree before any step can 
+            // be restored by undoing the journal backwards.
+            struct checkpoint_t {
+                // Step data of the last evaluation
+                struct step_t {
+                    Index block, key;
+                    Coord len;
+                    std::size_t journal_end;    // Journal of this step ends here
+                };
+                using step_allocator_type = typename std::allocator_traits<
+                    Alloc>::template rebind_alloc<step_t>;
+
+                // Clears and reserves for sz components.
+                void reset(std::size_t sz, std::size_t rev) {
+                    std::size_t max_cells = 1;  // Cells touched by an update
+                    while ((std::size_t(1) << max_cells) <= sz)
+                        ++max_cells;
+                    steps.resize(sz);
+                    tree.assign(sz, 0);
+                    journal_cells.resize(sz * max_cells);
+                    journal_values.resize(sz * max_cells);
+                    valid_steps = 0;
+                    revision = rev;
+                }
+
+                std::vector<step_t, step_allocator_type> steps;
+                std::vector<Coord, Alloc> tree, journal_values;
+                std::vector<Index, Alloc> journal_cells;
+                std::size_t valid_steps = 0;
+                std::size_t revision = 0;
+            };
+
+            // Implements operator(...) after the change as 
+            // DagPackGeneratorBase does.
+            template<typename LayoutAlloc, typename OtherAlloc>
+            std::pair<Coord, Coord> _sync_and_eval(Layout<LayoutAlloc, Coord> &layout,
+                resource_t &res, OtherAlloc &&alloc, Coord reject_width) {
+                auto &moved = this->_moved;
+                moved.begin(this->_size());
+                this->_sync_layout_sizes(layout);
+                auto area = moved.enabled() ?
+                    _eval(layout, moved.make_writer(layout.x_begin()), 
+                        moved.make_writer(layout.y_begin()), res, 
+                        std::forward<OtherAlloc>(alloc), reject_width) :
+                    _eval(layout, layout.x_begin(), layout.y_begin(), res,
+                        std::forward<OtherAlloc>(alloc), reject_width);
+                if (area.first < reject_width)
+                    moved.complete();
+                return area;
+            }
+
+            // Implements the evaluation stage of operator(...), writing the
+            // positions of layout to x_pos and y_pos.
+            template<typename LayoutAlloc, typename Pos, typename OtherAlloc>
+            std::pair<Coord, Coord> _eval(Layout<LayoutAlloc, Coord> &layout,
+                Pos x_pos, Pos y_pos, resource_t &res, OtherAlloc &&alloc, 
+                Coord reject_width = std::numeric_limits<Coord>::max()) {
                 using namespace std;
 
                 // Deal with auxilary buffer.
-                auto min_buffer_size = base_t::_min_buffer_size();
+                auto min_buffer_size = _min_buffer_size();
                 if (res.size() < min_buffer_size)
                     res.resize(min_buffer_size);
                 auto mem_src = res.data();
-                auto match = reinterpret_cast<size_t *>(mem_src);
-                mem_src += this->_size() * sizeof(size_t);
-                auto buffer = reinterpret_cast<size_t *>(mem_src);
-                mem_src += this->_size() * sizeof(size_t);
-
-                // Evaluate current state.
-                std::map<ptrdiff_t, ptrdiff_t, less<ptrdiff_t>, std::decay_t<OtherAlloc> >
-                    pq(std::less<ptrdiff_t>(), std::forward<OtherAlloc>(alloc));  // Note the decay_t
-                auto w = detail::eval_sp2(this->_sp_y.cbegin(), this->_sp_y.cend(),
-                    this->_sp_x.cbegin(), this->_widths.cbegin(), layout.x_begin(),
-                    buffer, match, pq);
-                auto h = detail::eval_sp2(this->_sp_y.cbegin(), this->_sp_y.cend(),
-                    this->_sp_x.crbegin(), this->_heights.cbegin(), layout.y_begin(),
-                    buffer, match, pq);
-
-                assert(match == reinterpret_cast<size_t *>(res.data()));
-                auto sln_area = make_pair(static_cast<int>(w), static_cast<int>(h));
+                const auto sz = this->_size();
+
+                // Evaluate current state. Engines other than map and veb read 
+                // keys from the maintained inv(y), and evaluate x and y in one
+                // pass. Staircases hold Coord, and match buffers hold Index.
+                Coord w = 0, h = 0;
+                switch (_active_engine()) {
+                case engine_t::map: {
+                    auto match = reinterpret_cast<Index *>(mem_src);
+                    auto buffer = match + sz;
+                    std::map<ptrdiff_t, ptrdiff_t, less<ptrdiff_t>, std::decay_t<OtherAlloc> >
+                        pq(std::less<ptrdiff_t>(), std::forward<OtherAlloc>(alloc));  // Note the decay_t
+                    w = detail::eval_sp2(this->_sp_y.cbegin(), this->_sp_y.cend(),
+                        this->_sp_x.cbegin(), this->_widths.cbegin(), x_pos,
+                        buffer, match, pq);
+                    if (w >= reject_width)
+                        return { w, 0 };
+                    h = detail::eval_sp2(this->_sp_y.cbegin(), this->_sp_y.cend(),
+                        this->_sp_x.crbegin(), this->_heights.cbegin(), y_pos,
+                        buffer, match, pq);
+                    break;
+                }
+
+                case engine_t::fenwick: {
+                    auto tree = reinterpret_cast<Coord *>(mem_src);
+                    tie(w, h) = detail::eval_sp2_xy_fenwick(this->_sp_x.cbegin(), 
+                        this->_sp_x.cend(), this->_inv_y.cbegin(), this->_widths.cbegin(),
+                        this->_heights.cbegin(), x_pos, y_pos,
+                        tree, tree + sz, reject_width);
+                    if (w >= reject_width)
+                        return { w, 0 };
+                    break;
+                }
+
+                case engine_t::veb: {
+                    auto words = reinterpret_cast<VebSet::word_t *>(mem_src);
+                    mem_src += aligned_bytes(VebSet::words_needed(sz) * sizeof(VebSet::word_t));
+                    auto vals = reinterpret_cast<Coord *>(mem_src);
+                    mem_src += aligned_bytes(sz * sizeof(Coord));
+                    auto match = reinterpret_cast<Index *>(mem_src);
+                    auto buffer = match + sz;
+                    w = detail::eval_sp2_veb(this->_sp_y.cbegin(), this->_sp_y.cend(),
+                        this->_sp_x.cbegin(), this->_widths.cbegin(), x_pos,
+                        buffer, match, words, vals);
+                    if (w >= reject_width)
+                        return { w, 0 };
+                    h = detail::eval_sp2_veb(this->_sp_y.cbegin(), this->_sp_y.cend(),
+                        this->_sp_x.crbegin(), this->_heights.cbegin(), y_pos,
+                        buffer, match, words, vals);
+                    break;
+                }
+
+                case engine_t::simd: {
+                    auto tops = reinterpret_cast<int32_t *>(mem_src);
+                    tie(w, h) = detail::eval_sp2_xy_simd(this->_sp_x.cbegin(),
+                        this->_sp_x.cend(), this->_inv_y.cbegin(), this->_widths.cbegin(),
+                        this->_heights.cbegin(), x_pos, y_pos,
+                        tops, tops + simd_tops_size(sz), static_cast<int32_t>(min<intmax_t>(
+                        reject_width, numeric_limits<int32_t>::max())));
+                    if (w >= reject_width)
+                        return { w, 0 };
+                    break;
+                }
+
+                case engine_t::incremental: {
+                    // inv(y) gives the keys of both dimensions
+                    w = _eval_incremental(_checkpoints[0], this->_sp_x.cbegin(), 
+                        this->_inv_y.cbegin(), this->_widths.cbegin(), x_pos);
+                    if (w >= reject_width)
+                        return { w, 0 };
+                    h = _eval_incremental(_checkpoints[1], this->_sp_x.crbegin(),
+                        this->_inv_y.cbegin(), this->_heights.cbegin(), y_pos);
+                    break;
+                }
+
+                default:
+                    assert(("no match for switch", false));
+                }
+
+                auto sln_area = make_pair(w, h);
 #ifndef NDEBUG
                 auto layout_area = layout.get_area();
                 if (sln_area != layout_area) {
@@ -763,20 +2079,565 @@ namespace rect_packing {
 #endif  
                 return sln_area;
             }
+
+            // Evaluates one dimension for engine_t::incremental: rolls the 
+            // checkpoint back to the first step that differs from the last
+            // evaluation, and recomputes the remaining steps only.
+            // Returns: width (height) of the packing.
+            template<typename FwdIt, typename RanIt0, typename RanIt1, typename RanIt2>
+            Coord _eval_incremental(checkpoint_t &cp, FwdIt x_begin,
+                RanIt0 inv_y, RanIt1 len, RanIt2 pos) {
+                using namespace std;
+                const auto sz = this->_size();
+                if (cp.revision != this->_revision || cp.steps.size() != sz)
+                    cp.reset(sz, this->_revision);
+
+                // Skip the unchanged prefix, whose positions are kept
+                size_t s = 0;
+                for (; s != cp.valid_steps; ++s, ++x_begin) {
+                    const auto &step = cp.steps[s];
+                    auto b = *x_begin;
+                    if (step.block != b || step.key != inv_y[b] || step.len != len[b])
+                        break;
+                }
+
+                // Undo the journal back to the checkpoint before step s
+                auto top = s ? cp.steps[s - 1].journal_end : 0;
+                if (cp.valid_steps) {
+                    auto k = cp.steps[cp.valid_steps - 1].journal_end;
+                    while (k != top) {
+                        --k;
+                        cp.tree[cp.journal_cells[k]] = cp.journal_values[k];
+                    }
+                }
+
+                // Recompute the remaining steps as eval_sp2_fenwick does
+                for (; s != sz; ++s, ++x_begin) {
+                    auto b = *x_begin;
+                    auto p = static_cast<size_t>(inv_y[b]);
+                    Coord t = 0;
+                    for (auto k = p; k; k &= k - 1)
+                        t = max(t, cp.tree[k - 1]);
+                    pos[b] = t;
+                    t += len[b];
+                    for (auto k = p + 1; k <= sz; k += k & (~k + 1)) {
+                        if (cp.tree[k - 1] < t) {
+                            cp.journal_cells[top] = static_cast<Index>(k - 1);
+                            cp.journal_values[top++] = cp.tree[k - 1];
+                            cp.tree[k - 1] = t;
+                        }
+                    }
+                    cp.steps[s] = { static_cast<Index>(b), static_cast<Index>(p), 
+                        len[b], top };
+                }
+                cp.valid_steps = sz;
+
+                Coord ans = 0;
+                for (auto k = sz; k; k &= k - 1)
+                    ans = max(ans, cp.tree[k - 1]);
+                return ans;
+            }
+
+            // Resolves engine_t::automatic by the size of the instance, and 
+            // engine_t::simd by the width of Coord.
+            engine_t _active_engine() const noexcept {
+                if (_engine == engine_t::simd)
+                    return simd_fits ? engine_t::simd : engine_t::fenwick;
+                if (_engine != engine_t::automatic)
+                    return _engine;
+                return simd_fits && this->_size() <= simd_max_size ? 
+                    engine_t::simd : engine_t::fenwick;
+            }
+
+            // Determines size of resource_t in bytes: storage of the selected
+            // engine. Map and veb need match and buffer for make_match first,
+            // while fused engines need their storage for both dimensions.
+            auto _min_buffer_size() const noexcept {
+                const auto sz = this->_size();
+                switch (_active_engine()) {
+                case engine_t::map:
+                    return 2 * sz * sizeof(Index);
+                case engine_t::fenwick:
+                    return 2 * sz * sizeof(Coord);
+                case engine_t::veb:
+                    return aligned_bytes(VebSet::words_needed(sz) * sizeof(VebSet::word_t)) +
+                        aligned_bytes(sz * sizeof(Coord)) + 2 * sz * sizeof(Index);
+                case engine_t::simd:
+                    return 2 * simd_tops_size(sz) * sizeof(std::int32_t);
+                default:
+                    return std::size_t(0);
+                }
+            }
+
+            // Whether Coord fits in the lanes of engine_t::simd.
+            static constexpr bool simd_fits = sizeof(Coord) <= sizeof(std::int32_t);
+
+            engine_t _engine = engine_t::automatic;
+            std::array<checkpoint_t, 2> _checkpoints;  // Of x and y
         };
 
-        template<typename Alloc0, typename Alloc1>
-        void unguarded_copy_generator(const DagPackGeneratorBase<Alloc0> &src,
-            DagPackGeneratorBase<Alloc1> &dest) {
+        template<typename Alloc0, typename Alloc1, typename Index, typename Coord>
+        void unguarded_copy_generator(const DagPackGeneratorBase<Alloc0, Index, Coord> &src,
+            DagPackGeneratorBase<Alloc1, Index, Coord> &dest) {
             unguarded_copy_unbuffered_generator(src, dest);
         }
 
-        template<typename Alloc0, typename Alloc1>
-        void unguarded_copy_unbuffered_generator(const DagPackGeneratorBase<Alloc0> &src,
-            DagPackGeneratorBase<Alloc1> &dest) {
+        template<typename Alloc0, typename Alloc1, typename Index, typename Coord>
+        void unguarded_copy_unbuffered_generator(
+            const DagPackGeneratorBase<Alloc0, Index, Coord> &src,
+            DagPackGeneratorBase<Alloc1, Index, Coord> &dest) {
             dest._unguarded_assign(src);
         }
 
+        // Smallest unsigned type holding [0, N].
+        template<std::size_t N>
+        using fixed_index_t = std::conditional_t<(N < 256), std::uint8_t,
+            std::conditional_t<(N < 65536), std::uint16_t, std::uint32_t>>;
+
+        // LCS-based sequence-pair packing generator of exactly N components.
+        // The state lives in std::array, and the evaluation buffers are
+        // embedded, so the generator needs no allocation and fits in L1 for
+        // N of a few hundred. Given the same random engine, moves are those 
+        // of LcsPackGeneratorBase.
+        template<std::size_t N>
+        class FixedLcsPackGeneratorBase : public PackGeneratorBase {
+            using self_t = FixedLcsPackGeneratorBase<N>;
+            using base_t = PackGeneratorBase;
+            using index_t = fixed_index_t<N>;
+            static constexpr bool uses_simd = N <= simd_max_size;
+
+        protected:
+            using size_vector_t = std::array<int, N>;
+            using sequence_pair_t = std::array<index_t, N>;
+            using momento_t = std::tuple<change_t, std::size_t, std::size_t>;
+            using buffer_t = std::conditional_t<uses_simd,
+                std::array<std::int32_t, 2 * simd_tops_size(N)>,
+                std::array<std::ptrdiff_t, 2 * N>>;
+
+        public:
+            using typename base_t::change_t;
+            using typename base_t::crossover_t;
+            using typename base_t::snapshot_t;
+            using typename base_t::default_change_distribution;
+            using allocator_type = std::allocator<void>;   // Unused
+            using index_type = index_t;
+            using coordinate_type = int;
+            struct resource_t { };                          // Embedded
+            using generator_tag = UnbufferedGeneratorTag;
+            using change_record_t = momento_t;              // (change, i, j)
+
+            static constexpr std::size_t fixed_size = N;
+
+            FixedLcsPackGeneratorBase() : FixedLcsPackGeneratorBase(allocator_type()) { }
+
+            explicit FixedLcsPackGeneratorBase(const allocator_type &) :
+                _last_change(change_t::none, 0, 0) {
+                _widths.fill(0);
+                _heights.fill(0);
+                std::iota(_sp_x.begin(), _sp_x.end(), index_t(0));
+                std::iota(_sp_y.begin(), _sp_y.end(), index_t(0));
+                std::iota(_inv_y.begin(), _inv_y.end(), index_t(0));
+            }
+
+            template<typename Cont0, typename Cont1, typename Eng>
+                FixedLcsPackGeneratorBase(Cont0 &&widths, Cont1 &&heights,
+                    Eng &&eng, const allocator_type &alloc = allocator_type()) :
+                FixedLcsPackGeneratorBase(alloc) {
+                construct(std::forward<Cont0>(widths), std::forward<Cont1>(heights),
+                    std::forward<Eng>(eng));
+            }
+
+            resource_t make_resource() const {
+                return resource_t();
+            }
+
+            resource_t make_resource(const allocator_type &) const {
+                return resource_t();
+            }
+
+            // Constructs from given args, which must hold N components. This 
+            // invalidates the subsequent call to rollback.
+            template<typename Cont0, typename Cont1, typename Eng>
+            void construct(Cont0 &&widths, Cont1 &&heights, Eng &&eng) {
+                using namespace std;
+                assert(static_cast<size_t>(distance(begin(widths), end(widths))) == N);
+                assert(static_cast<size_t>(distance(begin(heights), end(heights))) == N);
+                copy_n(begin(std::forward<Cont0>(widths)), N, _widths.begin());
+                copy_n(begin(std::forward<Cont1>(heights)), N, _heights.begin());
+                iota(_sp_x.begin(), _sp_x.end(), index_t(0));
+                iota(_sp_y.begin(), _sp_y.end(), index_t(0));
+                this->shuffle(std::forward<Eng>(eng));
+            }
+
+            // Computes packing layout, writes result to layout, and changes
+            // next internal state.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng,
+                typename ChgDist = default_change_distribution>
+                std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+                    Eng &&eng, resource_t &res, ChgDist &&chg_dist = ChgDist()) {
+                return this->operator()(layout, std::forward<Eng>(eng), res, 
+                    std::forward<ChgDist>(chg_dist), allocator_type(),
+                    std::numeric_limits<int>::max());
+            }
+
+            // Computes packing layout, writes result to layout, and changes
+            // next internal state.
+            // Arg alloc is ignored. This is for consistency with LcsPackGeneratorBase.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename ChgDist, typename OtherAlloc>
+            std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+                Eng &&eng, resource_t &res, ChgDist &&chg_dist, OtherAlloc &&alloc) {
+                return this->operator()(layout, std::forward<Eng>(eng), res,
+                    std::forward<ChgDist>(chg_dist), std::forward<OtherAlloc>(alloc),
+                    std::numeric_limits<int>::max());
+            }
+
+            // As above, but the evaluation may stop once the width reaches
+            // reject_width, as LcsPackGeneratorBase does.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename ChgDist, typename OtherAlloc>
+            std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+                Eng &&eng, resource_t &, ChgDist &&chg_dist, OtherAlloc &&, 
+                int reject_width) {
+                assert(layout.size() == N);
+                _change(std::forward<Eng>(eng), std::forward<ChgDist>(chg_dist));
+                return _sync_and_eval(layout, reject_width);
+            }
+
+            // One-shot rollback. If cannot rollback, does nothing.
+            // Cannot restore changed Layout.
+            bool rollback() {
+                change_t chg; std::size_t i, j;
+                std::tie(chg, i, j) = _last_change;
+                if (chg == change_t::none) {
+                    assert(false);
+                    return false;
+                }
+                _apply(chg, i, j, true);
+                std::get<0>(_last_change) = change_t::none;
+                return true;
+            }
+
+            // The last move, whose change is none if it has been rolled back.
+            const change_record_t &last_change() const noexcept {
+                return _last_change;
+            }
+
+            // Applies a move given by last_change() again, as 
+            // DagPackGeneratorBase does.
+            void redo(const change_record_t &rec) {
+                change_t chg; std::size_t i, j;
+                std::tie(chg, i, j) = rec;
+                if (chg != change_t::none)
+                    _apply(chg, i, j, false);
+                std::get<0>(_last_change) = change_t::none;
+            }
+
+            // Applies rec and evaluates the state as DagPackGeneratorBase does.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
+            std::pair<int, int> redo(const change_record_t &rec, Layout<LayoutAlloc> &layout,
+                Eng &&, resource_t &, OtherAlloc &&) {
+                assert(layout.size() == N);
+                redo(rec);
+                return _sync_and_eval(layout, std::numeric_limits<int>::max());
+            }
+
+            // Computes packing layout of the current state without moving, as
+            // DagPackGeneratorBase does.
+            // Returns: (width, height)
+            template<typename LayoutAlloc, typename Eng, typename OtherAlloc>
+            std::pair<int, int> pack(Layout<LayoutAlloc> &layout, Eng &&, resource_t &,
+                OtherAlloc &&) {
+                assert(layout.size() == N);
+                _unguarded_copy_layout_sizes(layout);
+                _size_sync.set_synced(std::addressof(layout));
+                _moved.reset();
+                return _eval(layout, layout.x_begin(), layout.y_begin(), 
+                    std::numeric_limits<int>::max(), std::integral_constant<bool, uses_simd>());
+            }
+
+            // Random shuffle. This invalidates the subsequent call to rollback.
+            template<typename Eng>
+            void shuffle(Eng &&eng, double p_rotate = 0.5) {
+                using namespace std;
+                bernoulli_distribution rand_bool(p_rotate);
+                for (size_t i = 0; i != N; ++i)
+                    if (rand_bool(eng))
+                        swap(_widths[i], _heights[i]);
+                std::shuffle(_sp_x.begin(), _sp_x.end(), eng);
+                std::shuffle(_sp_y.begin(), _sp_y.end(), eng);
+                detail::make_left_inverse(_sp_y.cbegin(), _sp_y.cend(), _inv_y.begin());
+                _last_change = forward_as_tuple(change_t::none, 0, 0);
+                _size_sync.reset();
+            }
+
+            // Makes this the child of lhs and rhs by crossover kind, as 
+            // DagPackGeneratorBase does.
+            template<typename Eng>
+            void crossover(const self_t &lhs, const self_t &rhs, crossover_t kind, Eng &&eng) {
+                using namespace std;
+                assert(this != addressof(lhs) && this != addressof(rhs));
+                size_t i = 0, j = N;
+                if (N >= 2)
+                    tie(i, j) = detail::random_long_range(eng, N);
+                sequence_pair_t inv_x;
+                detail::make_left_inverse(lhs._sp_x.cbegin(), lhs._sp_x.cend(), inv_x.begin());
+                bitset<N> taken;
+                detail::crossover_permutations(kind, lhs._sp_x.data(), inv_x.data(),
+                    rhs._sp_x.data(), N, i, j, _sp_x.data(), taken);
+                taken.reset();
+                detail::crossover_permutations(kind, lhs._sp_y.data(), lhs._inv_y.data(),
+                    rhs._sp_y.data(), N, i, j, _sp_y.data(), taken);
+                for (size_t k = 0; k != N; ++k) {
+                    auto c = _sp_x[k];
+                    const auto &parent = lhs._sp_x[k] == c ? lhs : rhs;
+                    _widths[c] = parent._widths[c];
+                    _heights[c] = parent._heights[c];
+                }
+                detail::make_left_inverse(_sp_y.cbegin(), _sp_y.cend(), _inv_y.begin());
+                _last_change = forward_as_tuple(change_t::none, 0, 0);
+                _size_sync.reset();
+            }
+
+            // Writes the state to snap, as DagPackGeneratorBase does.
+            template<typename Cont>
+            void save(snapshot_t &snap, const Cont &widths) const {
+                snap.sp_x.assign(_sp_x.begin(), _sp_x.end());
+                snap.sp_y.assign(_sp_y.begin(), _sp_y.end());
+                snap.rotated.resize(N);
+                auto it = std::begin(widths);
+                for (std::size_t c = 0; c != N; ++c, ++it)
+                    snap.rotated[c] = _widths[c] != *it;
+            }
+
+            // Restores the state from snap, as DagPackGeneratorBase does.
+            template<typename Cont0, typename Cont1>
+            void load(const snapshot_t &snap, const Cont0 &widths, const Cont1 &heights) {
+                using namespace std;
+                assert(snap.sp_x.size() == N && snap.sp_y.size() == N && 
+                    snap.rotated.size() == N);
+                for (size_t k = 0; k != N; ++k) {
+                    _sp_x[k] = static_cast<index_t>(snap.sp_x[k]);
+                    _sp_y[k] = static_cast<index_t>(snap.sp_y[k]);
+                }
+                auto w = begin(widths);
+                auto h = begin(heights);
+                for (size_t c = 0; c != N; ++c, ++w, ++h) {
+                    _widths[c] = static_cast<int>(snap.rotated[c] ? *h : *w);
+                    _heights[c] = static_cast<int>(snap.rotated[c] ? *w : *h);
+                }
+                detail::make_left_inverse(_sp_y.cbegin(), _sp_y.cend(), _inv_y.begin());
+                _last_change = forward_as_tuple(change_t::none, 0, 0);
+                _size_sync.reset();
+            }
+
+            static constexpr std::size_t size() noexcept {
+                return N;
+            }
+
+            static constexpr bool empty() noexcept {
+                return !N;
+            }
+
+            // Enables moved_cells(), which costs a comparison per position 
+            // written by an evaluation.
+            void set_tracks_moved_cells(bool enabled) {
+                _moved.set_enabled(enabled);
+            }
+
+            // Makes the next evaluation report all components as moved, e.g.
+            // after the layout has been replaced.
+            void reset_moved_cells() {
+                _moved.reset();
+            }
+
+            // Components whose positions or sizes were changed by the last
+            // evaluation in the layout it wrote to, if tracked.
+            const auto &moved_cells() const noexcept {
+                return _moved.cells();
+            }
+
+            template<std::size_t N1>
+            friend void unguarded_copy_unbuffered_generator(
+                const FixedLcsPackGeneratorBase<N1> &src, FixedLcsPackGeneratorBase<N1> &dest);
+
+        protected:
+            template<typename LayoutAlloc>
+            void _unguarded_copy_layout_sizes(Layout<LayoutAlloc> &layout) const {
+                std::copy_n(_widths.data(), N, std::addressof(*layout.widths_begin()));
+                std::copy_n(_heights.data(), N, std::addressof(*layout.heights_begin()));
+            }
+
+            // Synchronizes widths and heights of layout as DagPackGeneratorBase
+            // does.
+            template<typename LayoutAlloc>
+            void _sync_layout_sizes(Layout<LayoutAlloc> &layout) {
+                if (!_size_sync.is_synced(std::addressof(layout))) {
+                    _unguarded_copy_layout_sizes(layout);
+                    _moved.note_all();
+                } else {
+                    for (auto it = _size_sync.stale_begin(); it != _size_sync.stale_end(); ++it) {
+                        layout.widths_begin()[*it] = _widths[*it];
+                        layout.heights_begin()[*it] = _heights[*it];
+                        _moved.note(*it);
+                    }
+                }
+                _size_sync.set_synced(std::addressof(layout));
+            }
+
+            // Implements operator(...) after the change as 
+            // DagPackGeneratorBase does.
+            template<typename LayoutAlloc>
+            std::pair<int, int> _sync_and_eval(Layout<LayoutAlloc> &layout, int reject_width) {
+                _moved.begin(N);
+                _sync_layout_sizes(layout);
+                auto area = _moved.enabled() ?
+                    _eval(layout, _moved.make_writer(layout.x_begin()), 
+                        _moved.make_writer(layout.y_begin()), reject_width, 
+                        std::integral_constant<bool, uses_simd>()) :
+                    _eval(layout, layout.x_begin(), layout.y_begin(), reject_width, 
+                        std::integral_constant<bool, uses_simd>());
+                if (area.first < reject_width)
+                    _moved.complete();
+                return area;
+            }
+
+            // Evaluates layout, writing its positions to x_pos and y_pos.
+            template<typename LayoutAlloc, typename Pos>
+            std::pair<int, int> _eval(Layout<LayoutAlloc> &layout, Pos x_pos, Pos y_pos, 
+                int reject_width, std::true_type) {
+                auto tops = _buffer.data();
+                std::pair<int, int> area = detail::eval_sp2_xy_simd(_sp_x.cbegin(), 
+                    _sp_x.cend(), _inv_y.cbegin(), _widths.cbegin(), _heights.cbegin(), 
+                    x_pos, y_pos, tops, tops + simd_tops_size(N), reject_width);
+                assert(area.first >= reject_width || area == layout.get_area());
+                return area;
+            }
+
+            template<typename LayoutAlloc, typename Pos>
+            std::pair<int, int> _eval(Layout<LayoutAlloc> &layout, Pos x_pos, Pos y_pos, 
+                int reject_width, std::false_type) {
+                auto tree = _buffer.data();
+                std::pair<int, int> area = detail::eval_sp2_xy_fenwick(_sp_x.cbegin(),
+                    _sp_x.cend(), _inv_y.cbegin(), _widths.cbegin(), _heights.cbegin(),
+                    x_pos, y_pos, tree, tree + N, reject_width);
+                assert(area.first >= reject_width || area == layout.get_area());
+                return area;
+            }
+
+            // Draws the next move as DagPackGeneratorBase does, and applies it.
+            template<typename Eng, typename ChgDist>
+            bool _change(Eng &&eng, ChgDist &&chg_dist) {
+                using namespace std;
+                auto chg = std::forward<ChgDist>(chg_dist)(eng);
+                size_t i = 0, j = 0;
+                switch (chg) {
+                case change_t::none:
+                    return false;
+
+                case change_t::rotate:
+                    i = j = detail::bounded_random(eng, N);
+                    break;
+
+                case change_t::swap_x:
+                case change_t::swap_y:
+                case change_t::swap_xy:
+                    tie(i, j) = detail::random_distinct_pair(eng, N);
+                    break;
+
+                case change_t::reverse_x:
+                case change_t::reverse_y:
+                case change_t::reverse_xy:
+                case change_t::rotate_x:
+                case change_t::rotate_y:
+                case change_t::rotate_xy:
+                    tie(i, j) = detail::random_long_range(eng, N);
+                    break;
+
+                default:
+                    assert(("no match for switch", false));
+                }
+
+                _apply(chg, i, j, false);
+                _last_change = forward_as_tuple(chg, i, j);
+                return true;
+            }
+
+            // Applies move chg on (i, j), or undoes it if undo is true.
+            void _apply(change_t chg, std::size_t i, std::size_t j, bool undo) {
+                using namespace std;
+                bool on_x = chg == change_t::swap_x || chg == change_t::swap_xy ||
+                    chg == change_t::reverse_x || chg == change_t::reverse_xy ||
+                    chg == change_t::rotate_x || chg == change_t::rotate_xy;
+                bool on_y = chg == change_t::swap_y || chg == change_t::swap_xy ||
+                    chg == change_t::reverse_y || chg == change_t::reverse_xy ||
+                    chg == change_t::rotate_y || chg == change_t::rotate_xy;
+                auto permute = [&](sequence_pair_t &sp) {
+                    switch (chg) {
+                    case change_t::swap_x: case change_t::swap_y: case change_t::swap_xy:
+                        swap(sp[i], sp[j]);
+                        break;
+                    case change_t::reverse_x: case change_t::reverse_y: case change_t::reverse_xy:
+                        reverse(sp.data() + i, sp.data() + j);
+                        break;
+                    default:    // Rotations
+                        if (undo)
+                            rotate(sp.data() + i, sp.data() + j - 1, sp.data() + j);
+                        else
+                            rotate(sp.data() + i, sp.data() + i + 1, sp.data() + j);
+                        break;
+                    }
+                };
+
+                if (chg == change_t::rotate) {
+                    swap(_widths[i], _heights[i]);
+                    _size_sync.mark_stale(i);
+                }
+                if (on_x)
+                    permute(_sp_x);
+                if (on_y) {
+                    permute(_sp_y);
+                    if (chg == change_t::swap_y || chg == change_t::swap_xy) {
+                        _inv_y[_sp_y[i]] = static_cast<index_t>(i);
+                        _inv_y[_sp_y[j]] = static_cast<index_t>(j);
+                    } else {
+                        for (auto k = i; k != j; ++k)
+                            _inv_y[_sp_y[k]] = static_cast<index_t>(k);
+                    }
+                }
+            }
+
+            size_vector_t _widths, _heights;    // Copies of component sizes
+            sequence_pair_t _sp_x, _sp_y;
+            sequence_pair_t _inv_y;             // Kept in sync by every move
+            momento_t _last_change;             // One-shot info of last change 
+            buffer_t _buffer;                   // Staircases of x and y
+            MovedCellRecorder<index_t, int> _moved;
+            LayoutSizeSync _size_sync;
+        };
+
+        template<std::size_t N>
+        void unguarded_copy_generator(const FixedLcsPackGeneratorBase<N> &src,
+            FixedLcsPackGeneratorBase<N> &dest) {
+            unguarded_copy_unbuffered_generator(src, dest);
+        }
+
+        // Copies the state only, since the buffers are overwritten by each
+        // evaluation.
+        template<std::size_t N>
+        void unguarded_copy_unbuffered_generator(const FixedLcsPackGeneratorBase<N> &src,
+            FixedLcsPackGeneratorBase<N> &dest) {
+            dest._widths = src._widths;
+            dest._heights = src._heights;
+            dest._sp_x = src._sp_x;
+            dest._sp_y = src._sp_y;
+            dest._inv_y = src._inv_y;
+            dest._last_change = src._last_change;
+            dest._size_sync.reset();
+        }
+
         // Pack generator which owns resource made by its base class.
         template<typename BaseGenerator>
         class BufferedPackGenerator : public BaseGenerator {
@@ -791,7 +2652,12 @@ namespace rect_packing {
 
         public:
             using typename base_t::allocator_type;
+            using typename base_t::index_type;
+            using typename base_t::coordinate_type;
             using typename base_t::change_t;
+            using typename base_t::crossover_t;
+            using typename base_t::snapshot_t;
+            using typename base_t::change_record_t;
             using typename base_t::default_change_distribution;
             using unbuffered_generator_t = base_t;
             using buffered_generator_t = self_t;
@@ -809,22 +2675,38 @@ namespace rect_packing {
                     std::forward<Eng>(eng), alloc),
                 _resource(base_t::make_resource()) { }
 
-            template<typename LayoutAlloc, typename Eng, 
+            template<typename LayoutAlloc, typename Coord, typename Eng, 
                 typename ChgDist = default_change_distribution>
-            std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+            std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
                 Eng &&eng, ChgDist &&chg_dist = ChgDist()) {
                 return self_t::operator()(layout, std::forward<Eng>(eng),
                     std::forward<ChgDist>(chg_dist), allocator_type());
             }
 
-            template<typename LayoutAlloc, typename Eng,
+            template<typename LayoutAlloc, typename Coord, typename Eng,
                 typename ChgDist = default_change_distribution, typename OtherAlloc>
-                std::pair<int, int> operator()(Layout<LayoutAlloc> &layout,
+                std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
                     Eng &&eng, ChgDist &&chg_dist, OtherAlloc &&alloc) {
                 return base_t::operator()(layout, std::forward<Eng>(eng), _resource,
                     std::forward<ChgDist>(chg_dist), std::forward<OtherAlloc>(alloc));
             }
 
+            template<typename LayoutAlloc, typename Coord, typename Eng,
+                typename ChgDist, typename OtherAlloc>
+                std::pair<Coord, Coord> operator()(Layout<LayoutAlloc, Coord> &layout,
+                    Eng &&eng, ChgDist &&chg_dist, OtherAlloc &&alloc, Coord reject_width) {
+                return base_t::operator()(layout, std::forward<Eng>(eng), _resource,
+                    std::forward<ChgDist>(chg_dist), std::forward<OtherAlloc>(alloc),
+                    reject_width);
+            }
+
+            template<typename LayoutAlloc, typename Coord, typename Eng, typename OtherAlloc>
+            std::pair<Coord, Coord> pack(Layout<LayoutAlloc, Coord> &layout, Eng &&eng,
+                OtherAlloc &&alloc) {
+                return base_t::pack(layout, std::forward<Eng>(eng), _resource,
+                    std::forward<OtherAlloc>(alloc));
+            }
+
             template<typename BaseGenerator0, typename BaseGenerator1>
             friend void detail::unguarded_copy_generator(const BufferedPackGenerator<BaseGenerator0> &src,
                 BufferedPackGenerator<BaseGenerator1> &dest);
@@ -836,11 +2718,18 @@ namespace rect_packing {
         };
     }
 
-    template<typename Alloc = std::allocator<void> >
-    using DagPackGenerator = detail::BufferedPackGenerator<detail::DagPackGeneratorBase<Alloc>>;
+    template<typename Alloc = std::allocator<void>, typename Index = std::size_t,
+        typename Coord = int>
+    using DagPackGenerator = detail::BufferedPackGenerator<
+        detail::DagPackGeneratorBase<Alloc, Index, Coord>>;
+
+    template<typename Alloc = std::allocator<void>, typename Index = std::size_t,
+        typename Coord = int>
+    using LcsPackGenerator = detail::BufferedPackGenerator<
+        detail::LcsPackGeneratorBase<Alloc, Index, Coord>>;
 
-    template<typename Alloc = std::allocator<void> >
-    using LcsPackGenerator = detail::BufferedPackGenerator<detail::LcsPackGeneratorBase<Alloc>>;
+    template<std::size_t N>
+    using FixedLcsPackGenerator = detail::BufferedPackGenerator<detail::FixedLcsPackGeneratorBase<N>>;
 
     using rect_packing::detail::PackGeneratorBase;
 
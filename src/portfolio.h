@@ -0,0 +1,154 @@
+// portfolio.h: class Portfolio running differently configured packers
+//      concurrently.
+// Author: LYL (Aureliano Lee)
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "layout.h"
+#include "sa_packer.h"
+
+namespace rect_packing {
+
+    // Multi-start portfolio of packers of one layout, each run sequentially
+    // by a thread of its own. Instances may differ in seeds, generators,
+    // schedules and change distributions, but their energies must be of the
+    // same scale. An instance that has done checkpoint temperatures and whose
+    // min energy is still beyond the leader's by lag_ratio is cancelled, and
+    // stops with its best solution at its next temperature. The best layout
+    // is taken once every instance has finished or been cancelled.
+    template<typename LayoutAlloc, typename Coord>
+    class Portfolio {
+    public:
+        using layout_t = Layout<LayoutAlloc, Coord>;
+        using progress_t = SaPackerBase::progress_t;
+        // Packs layout, reporting to progress. Returns the energy.
+        using instance_t = std::function<double(layout_t &, progress_t &)>;
+
+        struct options_t {
+            std::size_t checkpoint = 100;   // Temperatures before an instance may be cancelled
+            double lag_ratio = 1.1;         // Of the leader's min energy
+            std::chrono::milliseconds poll_interval{ 5 };
+        };
+
+        struct result_t {
+            std::string name;
+            double energy;
+            std::size_t num_temperatures;
+            bool cancelled;
+        };
+
+        explicit Portfolio(const options_t &opts = options_t()) : _opts(opts) { }
+
+        const options_t &options() const {
+            return _opts;
+        }
+
+        void add(std::string name, instance_t instance) {
+            _names.push_back(std::move(name));
+            _instances.push_back(std::move(instance));
+        }
+
+        // Adds a copy of packer, which runs sequentially on lines
+        // [first_line, last_line) with a copy of chg_dist.
+        template<typename Packer, typename FwdIt, typename ChgDist>
+        void add(std::string name, const Packer &packer, FwdIt first_line, FwdIt last_line,
+            const ChgDist &chg_dist) {
+            add(std::move(name), [packer = packer, first_line, last_line, chg_dist = chg_dist](
+                layout_t &layout, progress_t &progress) mutable {
+                packer.set_progress(std::addressof(progress));
+                return packer(layout, first_line, last_line, chg_dist,
+                    std::allocator<void>(), 0);
+            });
+        }
+
+        auto size() const noexcept {
+            return _instances.size();
+        }
+
+        // Runs the instances and writes the best solution to layout.
+        // Returns: its energy
+        double operator()(layout_t &layout, unsigned verbose_level = 1) {
+            using namespace std;
+            auto n = _instances.size();
+            _results.clear();
+            if (!n)
+                return 0;
+
+            vector<progress_t> progress(n);
+            vector<layout_t> layouts(n, layout);
+            vector<double> energies(n);
+            vector<atomic<bool>> finished(n);   // Value-initialized to false
+            atomic<size_t> num_finished{ 0 };
+            vector<thread> thrds;
+            thrds.reserve(n);
+            for (size_t i = 0; i != n; ++i) {
+                thrds.emplace_back([&, i] {
+                    energies[i] = _instances[i](layouts[i], progress[i]);
+                    finished[i] = true;
+                    ++num_finished;
+                });
+            }
+
+            // Cancel laggards till all are done
+            vector<bool> cancelled(n, false);
+            while (num_finished != n) {
+                this_thread::sleep_for(_opts.poll_interval);
+                auto leader = numeric_limits<double>::max();
+                for (auto &p : progress)
+                    if (p.num_temperatures.load(memory_order_relaxed))
+                        leader = min(leader, p.min_energy.load(memory_order_relaxed));
+                if (leader == numeric_limits<double>::max())
+                    continue;
+                auto bound = leader + (_opts.lag_ratio - 1) * abs(leader);
+                for (size_t i = 0; i != n; ++i) {
+                    if (cancelled[i] || finished[i] ||
+                        progress[i].num_temperatures.load(memory_order_relaxed) < _opts.checkpoint ||
+                        !(progress[i].min_energy.load(memory_order_relaxed) > bound))
+                        continue;
+                    progress[i].cancelled = true;
+                    cancelled[i] = true;
+                }
+            }
+            for (auto &&t : thrds)
+                t.join();
+
+            for (size_t i = 0; i != n; ++i)
+                _results.push_back(result_t{ _names[i], energies[i],
+                    progress[i].num_temperatures.load(), cancelled[i] });
+            auto best = min_element(energies.cbegin(), energies.cend()) - energies.cbegin();
+            if (verbose_level) {
+                cout << "\n";
+                for (auto &r : _results)
+                    cout << "Instance " << r.name << ": energy " << r.energy << ", " <<
+                        r.num_temperatures << " temperatures" <<
+                        (r.cancelled ? ", cancelled" : "") << "\n";
+                cout << "Best instance: " << _names[best] << "\n";
+            }
+            layout = std::move(layouts[best]);
+            return energies[best];
+        }
+
+        // Results of the instances in the last run.
+        const std::vector<result_t> &results() const noexcept {
+            return _results;
+        }
+
+    private:
+        options_t _opts;
+        std::vector<std::string> _names;
+        std::vector<instance_t> _instances;
+        std::vector<result_t> _results;
+    };
+}
@@ -0,0 +1,230 @@
+// random_engine.h: class Xoshiro256ss and fast sampling helpers.
+// Author: LYL (Aureliano Lee)
+
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <utility>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace rect_packing {
+
+    // xoshiro256** by Blackman and Vigna: 256 bits of state, period
+    // 2^256 - 1, and 64 random bits per call with a few shifts and
+    // multiplications. Meets the UniformRandomBitGenerator concept.
+    class Xoshiro256ss {
+    public:
+        using result_type = std::uint64_t;
+
+        static constexpr result_type default_seed = 0x9e3779b97f4a7c15u;
+
+        Xoshiro256ss() noexcept : Xoshiro256ss(default_seed) { }
+
+        explicit Xoshiro256ss(result_type value) noexcept {
+            seed(value);
+        }
+
+        static constexpr result_type min() noexcept {
+            return 0;
+        }
+
+        static constexpr result_type max() noexcept {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        // Fills the state by splitmix64, which never makes it all zero.
+        void seed(result_type value = default_seed) noexcept {
+            for (auto &s : _s) {
+                auto z = (value += 0x9e3779b97f4a7c15u);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9u;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebu;
+                s = z ^ (z >> 31);
+            }
+        }
+
+        // Sets the state directly. Requires: not all zero.
+        void set_state(const std::array<result_type, 4> &s) noexcept {
+            _s = s;
+        }
+
+        result_type operator()() noexcept {
+            const auto ans = _rotl(_s[1] * 5, 7) * 9;
+            const auto t = _s[1] << 17;
+            _s[2] ^= _s[0];
+            _s[3] ^= _s[1];
+            _s[1] ^= _s[2];
+            _s[0] ^= _s[3];
+            _s[2] ^= t;
+            _s[3] = _rotl(_s[3], 45);
+            return ans;
+        }
+
+        void discard(unsigned long long z) noexcept {
+            for (; z; --z)
+                (*this)();
+        }
+
+        friend bool operator==(const Xoshiro256ss &lhs, const Xoshiro256ss &rhs) noexcept {
+            return lhs._s == rhs._s;
+        }
+
+        friend bool operator!=(const Xoshiro256ss &lhs, const Xoshiro256ss &rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+    private:
+        static result_type _rotl(result_type x, int k) noexcept {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        std::array<result_type, 4> _s;
+    };
+
+    namespace detail {
+        // Whether Eng gives 64 uniform bits per call.
+        template<typename Eng>
+        struct IsFullRange64Engine : public std::integral_constant<bool,
+            std::decay_t<Eng>::min() == 0 &&
+            std::decay_t<Eng>::max() == std::numeric_limits<std::uint64_t>::max()> { };
+
+        // High 64 bits of a * b, with the low ones written to lo.
+        inline std::uint64_t mul_hi(std::uint64_t a, std::uint64_t b,
+            std::uint64_t &lo) noexcept {
+#ifdef _MSC_VER
+            std::uint64_t hi;
+            lo = _umul128(a, b, &hi);
+            return hi;
+#else
+            auto m = static_cast<unsigned __int128>(a) * b;
+            lo = static_cast<std::uint64_t>(m);
+            return static_cast<std::uint64_t>(m >> 64);
+#endif
+        }
+
+        // Uniform integer on [0, n) by Lemire's multiply-shift, which
+        // divides only when it has to reject. Requires: n != 0.
+        template<typename Eng>
+        std::size_t bounded_random(Eng &&eng, std::size_t n) {
+            return bounded_random(eng, n, IsFullRange64Engine<Eng>());
+        }
+
+        template<typename Eng>
+        std::size_t bounded_random(Eng &eng, std::size_t n, std::false_type) {
+            return std::uniform_int_distribution<std::size_t>(0, n - 1)(eng);
+        }
+
+        template<typename Eng>
+        std::size_t bounded_random(Eng &eng, std::size_t n, std::true_type) {
+            const auto range = static_cast<std::uint64_t>(n);
+            std::uint64_t lo;
+            auto hi = mul_hi(eng(), range, lo);
+            if (lo < range) {
+                const auto threshold = (0 - range) % range;
+                while (lo < threshold)
+                    hi = mul_hi(eng(), range, lo);
+            }
+            return static_cast<std::size_t>(hi);
+        }
+
+        // Uniform pair of distinct indices in [0, n). Requires: n >= 2.
+        template<typename Eng>
+        std::pair<std::size_t, std::size_t> random_distinct_pair(Eng &&eng, std::size_t n) {
+            auto i = bounded_random(eng, n);
+            auto j = bounded_random(eng, n - 1);
+            return std::make_pair(i, j + (j >= i));
+        }
+
+        // Uniform range [i, j) of [0, n] with at least two elements.
+        // Requires: n >= 2.
+        template<typename Eng>
+        std::pair<std::size_t, std::size_t> random_long_range(Eng &&eng, std::size_t n) {
+            for (;;) {
+                auto p = random_distinct_pair(eng, n + 1);
+                if (p.first > p.second)
+                    std::swap(p.first, p.second);
+                if (p.second > p.first + 1)
+                    return p;
+            }
+        }
+
+        // Tables of the 256-layer ziggurat of the standard exponential
+        // distribution (Marsaglia and Tsang, 2000).
+        class ExponentialZiggurat {
+        public:
+            static constexpr double tail = 7.697117470131487;
+
+            static const ExponentialZiggurat &instance() {
+                static const ExponentialZiggurat zig;
+                return zig;
+            }
+
+            std::uint32_t ke[256];  // Thresholds of the fast path
+            double we[256];         // Scales of 32-bit integers to x
+            double fe[256];         // exp(-x) at layer edges
+
+        private:
+            ExponentialZiggurat() {
+                constexpr double m2 = 4294967296.0, ve = 3.949659822581572e-3;
+                double de = tail, te = tail;
+                const auto q = ve / std::exp(-de);
+                ke[0] = static_cast<std::uint32_t>(de / q * m2);
+                ke[1] = 0;
+                we[0] = q / m2;
+                we[255] = de / m2;
+                fe[0] = 1;
+                fe[255] = std::exp(-de);
+                for (int i = 254; i >= 1; --i) {
+                    de = -std::log(ve / de + std::exp(-de));
+                    ke[i + 1] = static_cast<std::uint32_t>(de / te * m2);
+                    te = de;
+                    fe[i] = std::exp(-de);
+                    we[i] = de / m2;
+                }
+            }
+        };
+
+        // Uniform double in [0, 1) from 53 random bits.
+        inline double to_unit_double(std::uint64_t bits) noexcept {
+            return static_cast<double>(bits >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        // Standard exponential variate, i.e. -log(u) for uniform u. With a
+        // 64-bit engine about 99% of draws take a table lookup and a
+        // multiplication only.
+        template<typename Eng>
+        double exponential_random(Eng &&eng) {
+            return exponential_random(eng, IsFullRange64Engine<Eng>());
+        }
+
+        template<typename Eng>
+        double exponential_random(Eng &eng, std::false_type) {
+            return std::exponential_distribution<>()(eng);
+        }
+
+        template<typename Eng>
+        double exponential_random(Eng &eng, std::true_type) {
+            const auto &zig = ExponentialZiggurat::instance();
+            for (;;) {
+                // Layer from the low bits, position from the high ones
+                auto bits = eng();
+                auto iz = static_cast<unsigned>(bits & 255);
+                auto jz = static_cast<std::uint32_t>(bits >> 32);
+                if (jz < zig.ke[iz])
+                    return jz * zig.we[iz];
+                if (iz == 0)
+                    return ExponentialZiggurat::tail - std::log(1 - to_unit_double(eng()));
+                auto x = jz * zig.we[iz];
+                if (zig.fe[iz] + to_unit_double(eng()) * (zig.fe[iz - 1] - zig.fe[iz]) <
+                    std::exp(-x))
+                    return x;
+            }
+        }
+    }
+}
@@ -3,17 +3,25 @@
 
 #include "xseqpair.h"
 #include <chrono>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include <boost/container/pmr/unsynchronized_pool_resource.hpp>
 #include <boost/container/pmr/synchronized_pool_resource.hpp>
 #include <boost/container/pmr/polymorphic_allocator.hpp>
 #include <boost/program_options.hpp>
 #include "aureliano/timeit.h"
 #include "aureliano/toolbox.h"
+#include "island_net.h"
 #include "layout.h"
+#include "netlist.h"
 #include "pack_generator.h"
+#include "portfolio.h"
 #include "sa_packer.h"
 #include "verification.h"
 
@@ -22,31 +30,217 @@ using namespace rect_packing;
 
 namespace {
 
-    template<typename Generator, typename Alloc, typename FwdIt>
-    void run_packer(SaPacker<Generator> &packer, Layout<Alloc> &layout, 
+    // Options given by command-line flags.
+    struct run_flags_t {
+        string policy = "par";  // Parallel policy: par, temper, spec or island
+        bool adaptive_moves = false;
+        // Genetic generations per temperature of policy par, and their crossover
+        size_t generations = 0;
+        PackGeneratorBase::crossover_t crossover = PackGeneratorBase::crossover_t::pmx;
+        size_t portfolio = 0;   // Sequential instances of a portfolio, if any
+        // Distributed islands: a coordinator of num_workers at coordinator_port, 
+        // or a worker exchanging with worker_host:worker_port
+        size_t num_workers = 0;
+        unsigned short coordinator_port = 0;
+        string worker_host;
+        unsigned short worker_port = 0;
+        size_t exchange_interval = 10;  // Temperatures between exchanges of a worker
+    };
+
+    // Wirelength of two-pin nets given by pairs.
+    template<typename Alloc, typename Coord, typename FwdIt>
+    double wirelength(const Layout<Alloc, Coord> &layout, FwdIt first, FwdIt last) {
+        return sum_manhattan_distances(layout, first, last);
+    }
+
+    // Wirelength of multi-pin nets.
+    template<typename Alloc, typename Coord>
+    double wirelength(const Layout<Alloc, Coord> &layout, 
+        Netlist::const_iterator first, Netlist::const_iterator last) {
+        return sum_half_perimeters(layout, first, last);
+    }
+
+    // Energy of a packing of w x h given its area and wirelength.
+    template<typename EFunc, typename Coord>
+    double packing_energy(const EFunc &func, double area, double wirelen, Coord, Coord) {
+        return func.alpha * area + (1 - func.alpha) * wirelen;
+    }
+
+    template<typename EFunc, typename Coord>
+    double packing_energy(const SaPackerBase::fixed_outline_energy_function<EFunc> &func,
+        double area, double wirelen, Coord w, Coord h) {
+        return packing_energy(func.base(), area, wirelen, w, h) + func.violation(w, h);
+    }
+
+    // Prints whether a packing of w x h fits in the outline, if any.
+    template<typename EFunc, typename Coord>
+    void print_feasibility(const EFunc &, Coord, Coord) { }
+
+    template<typename EFunc, typename Coord>
+    void print_feasibility(const SaPackerBase::fixed_outline_energy_function<EFunc> &func,
+        Coord w, Coord h) {
+        cout << "Outline: " << func.width << " " << func.height << ", " <<
+            (func.is_feasible(w, h) ? "feasible" : "infeasible") << "\n";
+    }
+
+    // Sets the LCS engine of the k-th instance of a portfolio, if any.
+    // Returns: its name
+    template<typename Packer>
+    string vary_engine(Packer &, size_t) {
+        return "";
+    }
+
+    template<typename Alloc, typename Index, typename Coord, typename EFunc>
+    string vary_engine(SaPacker<LcsPackGenerator<Alloc, Index, Coord>, EFunc> &packer,
+        size_t k) {
+        using generator_t = typename LcsPackGenerator<Alloc, Index, Coord>::unbuffered_generator_t;
+        using engine_t = typename generator_t::engine_t;
+        static const pair<engine_t, const char *> engines[] = {
+            { engine_t::automatic, "automatic" }, { engine_t::fenwick, "fenwick" },
+            { engine_t::veb, "veb" }, { engine_t::incremental, "incremental" }
+        };
+        auto &e = engines[k % (sizeof(engines) / sizeof(engines[0]))];
+        auto gen = packer.generator();
+        gen.set_engine(e.first);
+        packer.set_generator(gen);
+        return string(", engine ") + e.second;
+    }
+
+    // Packs by a portfolio of num_instances sequential copies of packer, 
+    // which differ in seeds, schedules, change distributions and engines.
+    template<typename Generator, typename EFunc, typename Alloc, typename Coord, 
+        typename FwdIt, typename ChgDist, typename AdaptiveChgDist>
+    double run_portfolio(const SaPacker<Generator, EFunc> &packer, Layout<Alloc, Coord> &layout,
+        FwdIt first_line, FwdIt last_line, const ChgDist &chg_dist, 
+        const AdaptiveChgDist &adaptive_chg_dist, size_t num_instances, unsigned verbose_level) {
+        static const double cooling_factors[] = { 1, 2, 0.5 };   // Of 1 - decreasing_ratio
+        Portfolio<Alloc, Coord> portfolio;
+        for (size_t k = 0; k != num_instances; ++k) {
+            auto instance = packer;
+            instance.seed(SEQPAIR_RANDOM_SEED());
+            auto opts = packer.options();
+            opts.decreasing_ratio = 1 - (1 - opts.decreasing_ratio) * cooling_factors[k % 3];
+            instance.set_options(opts);
+            ostringstream name;
+            name << k << " (decreasing ratio " << opts.decreasing_ratio <<
+                (k % 2 ? ", adaptive moves" : "") << vary_engine(instance, k) << ")";
+            if (k % 2)
+                portfolio.add(name.str(), instance, first_line, last_line, adaptive_chg_dist);
+            else
+                portfolio.add(name.str(), instance, first_line, last_line, chg_dist);
+        }
+        return portfolio(layout, verbose_level);
+    }
+
+    // Packs sequentially as an island of a coordinator, to which the best
+    // state is sent at last.
+    template<typename Generator, typename EFunc, typename Alloc, typename Coord,
+        typename FwdIt, typename ChgDist, typename RuntimeAlloc>
+    double run_worker(SaPacker<Generator, EFunc> &packer, Layout<Alloc, Coord> &layout,
+        FwdIt first_line, FwdIt last_line, ChgDist &chg_dist, RuntimeAlloc &alloc,
+        unsigned verbose_level, const run_flags_t &flags) {
+        net::IslandWorker worker(flags.worker_host, flags.worker_port, layout.size());
+        auto widths = layout.widths();  // Packing may rotate them
+        packer.set_migration(worker.migration(flags.exchange_interval));
+        auto cost = packer(layout, first_line, last_line, chg_dist, alloc, verbose_level);
+        packer.set_migration(SaPackerBase::migration_t());
+        if (!worker.connected())
+            cout << "Warning: lost connection to coordinator." << "\n";
+        net::snapshot_t snap;
+        packer.generator().save(snap, widths);
+        worker.finish(snap, cost);
+        return cost;
+    }
+
+    // Collects the best state of the workers and packs it to layout.
+    // Returns: its energy reported by the worker
+    template<typename Generator, typename EFunc, typename Alloc, typename Coord,
+        typename RuntimeAlloc>
+    double run_coordinator(const SaPacker<Generator, EFunc> &packer, 
+        Layout<Alloc, Coord> &layout, RuntimeAlloc &alloc, unsigned verbose_level, 
+        const run_flags_t &flags) {
+        net::IslandCoordinator coordinator(flags.coordinator_port, flags.num_workers, 
+            layout.size());
+        cout << "Listening on port " << coordinator.port() << "\n";
+        if (!coordinator.run(verbose_level))
+            throw runtime_error("No state received from workers");
+        auto gen = packer.generator();
+        Xoshiro256ss eng;
+        gen.construct(layout.widths(), layout.heights(), eng);
+        gen.load(coordinator.best(), layout.widths(), layout.heights());
+        auto res = gen.make_resource();
+        gen.pack(layout, eng, res, alloc);
+        return coordinator.best_energy();
+    }
+
+    template<typename Generator, typename EFunc, typename Alloc, typename Coord, 
+        typename FwdIt>
+    void run_packer(SaPacker<Generator, EFunc> &packer, Layout<Alloc, Coord> &layout, 
         FwdIt first_line, FwdIt last_line, ostream &out, unsigned num_thrds, 
-        unsigned verbose_level) {
+        unsigned verbose_level, const run_flags_t &flags) {
         using namespace rect_packing::verification;
         using change_t = PackGeneratorBase::change_t;
 
         cout << "Threads: " << num_thrds << "\n";
+        if (flags.num_workers)
+            cout << "Coordinator of " << flags.num_workers << " workers" << "\n";
+        else if (!flags.worker_host.empty())
+            cout << "Worker of " << flags.worker_host << ":" << flags.worker_port <<
+                ", exchange interval: " << flags.exchange_interval << "\n";
+        else if (flags.portfolio)
+            cout << "Portfolio: " << flags.portfolio << " instances" << "\n";
+        else if (num_thrds > 1)
+            cout << "Policy: " << flags.policy << "\n";
         cout << packer.options();
+        if (flags.adaptive_moves)
+            cout << "Adaptive moves" << "\n";
+        if (!flags.portfolio && num_thrds > 1 && flags.policy == "par" && flags.generations)
+            cout << "Genetic generations: " << flags.generations << ", crossover: " <<
+                PackGeneratorBase::crossover_name(flags.crossover) << "\n";
 
         // Change distribution and runtime allocator
         // Note: maybe pool_options can be specified
         PackGeneratorBase::default_change_distribution chg_dist;
+        PackGeneratorBase::adaptive_change_distribution adaptive_chg_dist(chg_dist);
         boost::container::pmr::unsynchronized_pool_resource pool_resource;
         boost::container::pmr::polymorphic_allocator<char> pmr_alloc(
             std::addressof(pool_resource));
 
         double cost = 0;
-        auto runtime = aureliano::timeit([&] {
-            if (num_thrds <= 1)
+        auto pack = [&](auto &dist) {
+            if (!flags.worker_host.empty())
+                cost = run_worker(packer, layout, first_line, last_line, dist, pmr_alloc,
+                    verbose_level, flags);
+            else if (num_thrds <= 1)
                 cost = packer(layout, first_line, last_line,
-                    chg_dist, pmr_alloc, verbose_level);
+                    dist, pmr_alloc, verbose_level);
+            else if (flags.policy == "temper")
+                cost = packer(packer.temper, layout, first_line, last_line,
+                    dist, pmr_alloc, verbose_level, num_thrds);
+            else if (flags.policy == "spec")
+                cost = packer(packer.spec, layout, first_line, last_line,
+                    dist, pmr_alloc, verbose_level, num_thrds);
+            else if (flags.policy == "island")
+                cost = packer(packer.island, layout, first_line, last_line,
+                    dist, pmr_alloc, verbose_level, num_thrds);
+            else if (flags.generations)
+                cost = packer(packer.par, layout, first_line, last_line,
+                    dist, pmr_alloc, verbose_level, num_thrds, 
+                    SaPackerBase::genetic_population_update(flags.crossover, flags.generations));
             else
                 cost = packer(packer.par, layout, first_line, last_line,
-                    chg_dist, pmr_alloc, verbose_level, num_thrds);
+                    dist, pmr_alloc, verbose_level, num_thrds);
+        };
+        auto runtime = aureliano::timeit([&] {
+            if (flags.num_workers)
+                cost = run_coordinator(packer, layout, pmr_alloc, verbose_level, flags);
+            else if (flags.portfolio)
+                cost = run_portfolio(packer, layout, first_line, last_line, chg_dist,
+                    adaptive_chg_dist, flags.portfolio, verbose_level);
+            else if (flags.adaptive_moves)
+                pack(adaptive_chg_dist);
+            else
+                pack(chg_dist);
         });
 
         cout << "\n";
@@ -56,33 +250,147 @@ namespace {
         auto sum_rect_areas = layout.sum_conponent_areas();
         cout << "Sum of rectangle areas: " << sum_rect_areas << "\n";
         auto sln_area = layout.get_area();
+        auto area = static_cast<typename Layout<Alloc, Coord>::area_type>(sln_area.first) *
+            sln_area.second;
         {
             using namespace rect_packing::io;
-            cout << "Area: " << sln_area.first * sln_area.second <<
-                " " << sln_area << "\n";
+            cout << "Area: " << area << " " << sln_area << "\n";
         }
-        cout << "Utilization: " << 1.0 * sum_rect_areas /
-            (sln_area.first * sln_area.second) << "\n";
-        auto wirelen = sum_manhattan_distances(layout, first_line, last_line);
+        cout << "Utilization: " << 1.0 * sum_rect_areas / area << "\n";
+        auto wirelen = wirelength(layout, first_line, last_line);
         cout << "Wirelength: " << wirelen << "\n";
         cout << "Cost: " << cost << "\n";
+        print_feasibility(packer.energy_function(), sln_area.first, sln_area.second);
 
-        auto alpha = packer.energy_function().alpha;
-        if (abs(alpha * sln_area.first * sln_area.second + (1 - alpha) * wirelen - cost) > 
-            16 * numeric_limits<double>().epsilon())
+        pair<size_t, size_t> overlap;
+        if (!is_cost_consistent(cost, packing_energy(packer.energy_function(), 
+            static_cast<double>(area), wirelen, sln_area.first, sln_area.second)))
             cout << "Wrong answer: incorrect cost." << "\n";
-        else if (has_intersection(layout))
-            cout << "Wrong answer: layout contains intersections." << "\n";
+        else if (find_intersection(layout, overlap, num_thrds))
+            cout << "Wrong answer: layout contains intersections, e.g. components " <<
+                overlap.first << " and " << overlap.second << "." << "\n";
         else
             cout << "Answer accepted.\n";
 
-        using format_policy = typename Layout<Alloc>::format_policy;
+        using format_policy = typename Layout<Alloc, Coord>::format_policy;
         out << layout.format(format_policy::no_delim);
     }
 
     void print_usage() {
         cout << "Usage: rect_file, net_file, alpha, method, "
-            "result_file [num_thrds=1] [verbose_level=1] [option_file]" << "\n";
+            "result_file [num_thrds=1] [verbose_level=1] [option_file] "
+            "[--outline=WIDTHxHEIGHT] [--adaptive-moves] [--incremental-wirelength] "
+            "[--multi-pin-nets] [--policy=POLICY] [--crossover=pmx|order|cycle] [--generations=N] "
+            "[--portfolio=K] [--coordinator=PORT:WORKERS] [--worker=HOST:PORT] [--exchange-interval=T]" << "\n";
+        cout << "Methods: dag, lcs, lcs-map, lcs-fenwick, lcs-veb, lcs-incremental, lcs-simd, "
+            "lcs-fixed (32, 64 or 128 rectangles)" << "\n";
+        cout << "Net file: pairs of two-pin nets, or a net of pins per line with "
+            "--multi-pin-nets" << "\n";
+        cout << "Incremental wirelength: update two-pin wirelength by moved rectangles only"
+            << "\n";
+        cout << "Policies of multiple threads: par (default), temper (replica exchange), "
+            "spec (speculative moves), island (asynchronous islands)" << "\n";
+        cout << "Crossover and generations: genetic stage after each temperature of par "
+            "(1 generation if only crossover is given)" << "\n";
+        cout << "Portfolio: K sequential instances of varied settings, laggards cancelled" << "\n";
+        cout << "Coordinator and worker: distributed islands over TCP, each worker "
+            "sequential and exchanging best states every T temperatures (default 10)" << "\n";
+    }
+
+    // Parses the LCS engine from method of form "lcs[-engine]".
+    template<typename Generator>
+    bool parse_lcs_engine(const string &method, typename Generator::engine_t &engine) {
+        using engine_t = typename Generator::engine_t;
+        if (method == "lcs")
+            return true;
+        if (method == "lcs-map")
+            engine = engine_t::map;
+        else if (method == "lcs-fenwick")
+            engine = engine_t::fenwick;
+        else if (method == "lcs-veb")
+            engine = engine_t::veb;
+        else if (method == "lcs-incremental")
+            engine = engine_t::incremental;
+        else if (method == "lcs-simd")
+            engine = engine_t::simd;
+        else
+            return false;
+        return true;
+    }
+
+    // Runs FixedLcsPackGenerator, which holds int coordinates only.
+    template<typename EFunc, typename Alloc, typename FwdIt>
+    void run_fixed_packer(const SaPackerBase::options_t &opts, 
+        const EFunc &func, Layout<Alloc, int> &layout,
+        FwdIt first_line, FwdIt last_line, ostream &out, unsigned num_thrds, 
+        unsigned verbose_level, const run_flags_t &flags) {
+        if (layout.size() == 32) {
+            auto packer = makeSaPacker<FixedLcsPackGenerator<32>>(opts, func);
+            run_packer(packer, layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+        } else if (layout.size() == 64) {
+            auto packer = makeSaPacker<FixedLcsPackGenerator<64>>(opts, func);
+            run_packer(packer, layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+        } else if (layout.size() == 128) {
+            auto packer = makeSaPacker<FixedLcsPackGenerator<128>>(opts, func);
+            run_packer(packer, layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+        } else {
+            throw invalid_argument("No fixed-size generator for this number of rectangles");
+        }
+    }
+
+    template<typename EFunc, typename Alloc, typename Coord, typename FwdIt>
+    void run_fixed_packer(const SaPackerBase::options_t &, const EFunc &, 
+        Layout<Alloc, Coord> &, FwdIt, FwdIt, ostream &, unsigned, unsigned, 
+        const run_flags_t &) {
+        throw invalid_argument("Rectangles too large for the fixed-size generator");
+    }
+
+    // Runs method with sequence pairs of Index and coordinates of Coord.
+    template<typename Index, typename Coord, typename EFunc, typename Alloc, typename FwdIt>
+    void run_method(const string &method, const SaPackerBase::options_t &opts, 
+        const EFunc &func, 
+        const Layout<Alloc, std::int64_t> &input, FwdIt first_line, FwdIt last_line, 
+        ostream &out, unsigned num_thrds, unsigned verbose_level, const run_flags_t &flags) {
+        cout << "Index type: " << 8 * sizeof(Index) << " bits, coordinate type: " <<
+            8 * sizeof(Coord) << " bits" << "\n";
+        Layout<Alloc, Coord> layout;
+        for (size_t i = 0; i != input.size(); ++i)
+            layout.push(static_cast<Coord>(input.widths()[i]), 
+                static_cast<Coord>(input.heights()[i]));
+
+        if (method == "dag") {
+            cout << "Method: DAG" << "\n";
+            auto packer = makeSaPacker<DagPackGenerator<std::allocator<void>, Index, Coord>>(
+                opts, func);
+            run_packer(packer, layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+
+        } else if (method == "lcs-fixed") {
+            cout << "Method: LCS (fixed size)" << "\n";
+            run_fixed_packer(opts, func, layout, first_line, last_line, out, num_thrds, 
+                verbose_level, flags);
+
+        } else {
+            cout << "Method: LCS" << "\n";
+            using generator_t = LcsPackGenerator<std::allocator<void>, Index, Coord>;
+            typename generator_t::unbuffered_generator_t lcs_gen;
+            auto lcs_engine = lcs_gen.engine();
+            parse_lcs_engine<typename generator_t::unbuffered_generator_t>(method, lcs_engine);
+            lcs_gen.set_engine(lcs_engine);
+            auto packer = makeSaPacker<generator_t>(opts, func);
+            packer.set_generator(lcs_gen);
+            run_packer(packer, layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+        }
+    }
+
+    // Chooses the narrowest index type holding [0, n).
+    template<typename Coord, typename... Types>
+    void run_method_with_coordinate(size_t n, Types &&...args) {
+        if (n <= numeric_limits<std::uint16_t>::max())
+            run_method<std::uint16_t, Coord>(std::forward<Types>(args)...);
+        else if (n <= numeric_limits<std::uint32_t>::max())
+            run_method<std::uint32_t, Coord>(std::forward<Types>(args)...);
+        else
+            run_method<size_t, Coord>(std::forward<Types>(args)...);
     }
 }
 
@@ -90,37 +398,146 @@ namespace {
 int main(int argc, char **argv) {
     try {
         bool is_argv_valid = false;
-        if (argc < 6) {
+
+        // Fixed outline of form --outline=WIDTHxHEIGHT may appear anywhere
+        vector<string> args;
+        double outline_width = 0, outline_height = 0;
+        bool has_outline = false, incremental_wirelength = false, multi_pin_nets = false;
+        run_flags_t flags;
+        const string outline_prefix = "--outline=", policy_prefix = "--policy=",
+            crossover_prefix = "--crossover=", generations_prefix = "--generations=",
+            portfolio_prefix = "--portfolio=", coordinator_prefix = "--coordinator=",
+            worker_prefix = "--worker=", exchange_interval_prefix = "--exchange-interval=";
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--adaptive-moves") {
+                flags.adaptive_moves = true;
+                continue;
+            }
+            if (arg.compare(0, policy_prefix.size(), policy_prefix) == 0) {
+                flags.policy = arg.substr(policy_prefix.size());
+                if (flags.policy != "par" && flags.policy != "temper" && 
+                    flags.policy != "spec" && flags.policy != "island")
+                    throw invalid_argument("Invalid policy");
+                continue;
+            }
+            if (arg == "--incremental-wirelength") {
+                incremental_wirelength = true;
+                continue;
+            }
+            if (arg == "--multi-pin-nets") {
+                multi_pin_nets = true;
+                continue;
+            }
+            if (arg.compare(0, crossover_prefix.size(), crossover_prefix) == 0) {
+                using crossover_t = PackGeneratorBase::crossover_t;
+                auto kind = arg.substr(crossover_prefix.size());
+                if (kind == "pmx")
+                    flags.crossover = crossover_t::pmx;
+                else if (kind == "order")
+                    flags.crossover = crossover_t::order;
+                else if (kind == "cycle")
+                    flags.crossover = crossover_t::cycle;
+                else
+                    throw invalid_argument("Invalid crossover");
+                flags.generations = max<size_t>(flags.generations, 1);
+                continue;
+            }
+            if (arg.compare(0, generations_prefix.size(), generations_prefix) == 0) {
+                char *end = nullptr;
+                flags.generations = strtoull(arg.c_str() + generations_prefix.size(), &end, 10);
+                if (*end)
+                    throw invalid_argument("Invalid generations");
+                continue;
+            }
+            if (arg.compare(0, portfolio_prefix.size(), portfolio_prefix) == 0) {
+                char *end = nullptr;
+                flags.portfolio = strtoull(arg.c_str() + portfolio_prefix.size(), &end, 10);
+                if (*end || !flags.portfolio)
+                    throw invalid_argument("Invalid portfolio");
+                continue;
+            }
+            if (arg.compare(0, coordinator_prefix.size(), coordinator_prefix) == 0) {
+                char *end = nullptr;
+                auto port = strtoul(arg.c_str() + coordinator_prefix.size(), &end, 10);
+                if (*end != ':' || port > numeric_limits<unsigned short>::max())
+                    throw invalid_argument("Invalid coordinator");
+                flags.coordinator_port = static_cast<unsigned short>(port);
+                flags.num_workers = strtoull(end + 1, &end, 10);
+                if (*end || !flags.num_workers)
+                    throw invalid_argument("Invalid coordinator");
+                continue;
+            }
+            if (arg.compare(0, worker_prefix.size(), worker_prefix) == 0) {
+                auto colon = arg.rfind(':');
+                if (colon == string::npos || colon <= worker_prefix.size())
+                    throw invalid_argument("Invalid worker");
+                flags.worker_host = arg.substr(worker_prefix.size(), colon - worker_prefix.size());
+                char *end = nullptr;
+                auto port = strtoul(arg.c_str() + colon + 1, &end, 10);
+                if (*end || !port || port > numeric_limits<unsigned short>::max())
+                    throw invalid_argument("Invalid worker");
+                flags.worker_port = static_cast<unsigned short>(port);
+                continue;
+            }
+            if (arg.compare(0, exchange_interval_prefix.size(), exchange_interval_prefix) == 0) {
+                char *end = nullptr;
+                flags.exchange_interval = strtoull(
+                    arg.c_str() + exchange_interval_prefix.size(), &end, 10);
+                if (*end || !flags.exchange_interval)
+                    throw invalid_argument("Invalid exchange interval");
+                continue;
+            }
+            if (arg.compare(0, outline_prefix.size(), outline_prefix) != 0) {
+                args.push_back(arg);
+                continue;
+            }
+            char *end = nullptr;
+            outline_width = strtod(arg.c_str() + outline_prefix.size(), &end);
+            if (*end != 'x' && *end != 'X')
+                throw invalid_argument("Invalid outline");
+            outline_height = strtod(end + 1, &end);
+            if (*end || !(outline_width > 0) || !(outline_height > 0))
+                throw invalid_argument("Invalid outline");
+            has_outline = true;
+        }
+        if (flags.num_workers && !flags.worker_host.empty())
+            throw invalid_argument("Coordinator and worker are exclusive");
+        if (args.size() < 5) {
             print_usage();
             return EXIT_FAILURE;
         }
 
-        string rect_file = argv[1], net_file = argv[2];
-        double alpha = strtod(argv[3], nullptr);
-        string method = argv[4];
-        string result_file = argv[5];
+        string rect_file = args[0], net_file = args[1];
+        double alpha = strtod(args[2].c_str(), nullptr);
+        string method = args[3];
+        string result_file = args[4];
         unsigned num_thrds = 1;
-        if (argc > 6)
-            num_thrds = strtoull(argv[6], nullptr, 10);
+        if (args.size() > 5)
+            num_thrds = strtoull(args[5].c_str(), nullptr, 10);
         unsigned verbose_level = 1;
-        if (argc > 7)
-            verbose_level = strtoul(argv[7], nullptr, 10);
+        if (args.size() > 6)
+            verbose_level = strtoul(args[6].c_str(), nullptr, 10);
         string opt_file;
-        if (argc > 8)
-            opt_file = argv[8];
-        if (argc > 9)
+        if (args.size() > 7)
+            opt_file = args[7];
+        if (args.size() > 8)
             cout << "Warning: extra command-line arguments are ommitted." << "\n";
 
         for (auto &e : method)
             e = tolower(e);
-        if (num_thrds && (method == "lcs" || method == "dag"))
+        using lcs_generator_t = LcsPackGenerator<>::unbuffered_generator_t;
+        auto lcs_engine = lcs_generator_t().engine();
+        if (num_thrds && (method == "dag" || method == "lcs-fixed" ||
+            parse_lcs_engine<lcs_generator_t>(method, lcs_engine)))
             is_argv_valid = true;
         if (!is_argv_valid) {
             print_usage();
             return EXIT_FAILURE;
         }
 
-        Layout<> layout;
+        // Read in the widest type, narrowed below
+        Layout<std::allocator<void>, std::int64_t> layout;
         {
             ifstream in(rect_file);
             if (!in.is_open())
@@ -128,20 +545,34 @@ int main(int argc, char **argv) {
             in >> layout;
         }
 
-        vector<pair<size_t, size_t>> nets;
+        // Pairs of two-pin nets, or a net of pins per line if asked
+        Netlist netlist;
         {
             ifstream in(net_file);
             if (!in.is_open())
                 throw runtime_error("Cannot open file");
-            size_t i, j;
-            while (in >> i >> j) {
-                nets.emplace_back(i, j);
+            if (multi_pin_nets) {
+                in >> netlist;
+            } else {
+                size_t pins[2];
+                while (in >> pins[0] >> pins[1])
+                    netlist.push(pins, pins + 2);
             }
-            using const_reference = typename decltype(nets)::const_reference;
-            if (any_of(nets.cbegin(), nets.cend(), [&](const_reference p) {
-                return p.first >= layout.size() || p.second >= layout.size(); }))
+            if (!in.eof())
+                throw invalid_argument("Invalid net file");
+            if (any_of(netlist.pins().cbegin(), netlist.pins().cend(), [&](size_t p) {
+                return p >= layout.size(); }))
                 throw invalid_argument("Net index out of range");
         }
+        // Two-pin nets are kept in SoA form for the SIMD wirelength kernel
+        bool is_two_pin = netlist.max_degree() == 2 && 
+            netlist.num_pins() == 2 * netlist.size() &&
+            layout.size() <= numeric_limits<TwoPinNetlist::index_type>::max();
+        TwoPinNetlist nets;
+        if (is_two_pin) {
+            for (auto net : netlist)
+                nets.push(net.begin()[0], net.begin()[1]);
+        }
 
         SaPackerBase::options_t opts;
         if (!opt_file.empty()) {
@@ -157,25 +588,45 @@ int main(int argc, char **argv) {
                 opts.restart_ratio = 2.3;
         }
 
+        // No packing is wider or higher than the sum of the longer sides, 
+        // which decides whether 32-bit coordinates are safe.
+        std::int64_t max_extent = 0;
+        for (size_t i = 0; i != layout.size(); ++i) {
+            if (layout.widths()[i] < 0 || layout.heights()[i] < 0)
+                throw invalid_argument("Negative rectangle size");
+            max_extent += max(layout.widths()[i], layout.heights()[i]);
+        }
+
         cout << "Rectangles: " << layout.size() << "\n";
-        cout << "Alpha: " << alpha << "\n" << "\n";
-        SaPackerBase::default_energy_function func(alpha);
-        {
+        cout << "Nets: " << netlist.size() << ", pins: " << netlist.num_pins() << "\n";
+        cout << "Alpha: " << alpha << "\n";
+        if (has_outline)
+            cout << "Outline: " << outline_width << " " << outline_height << "\n";
+        cout << "\n";
+        auto run_with = [&](const auto &func, auto first_line, auto last_line) {
             ofstream out(result_file);
-            if (method == "dag") {
-                cout << "Method: DAG" << "\n";
-                auto packer = makeSaPacker<DagPackGenerator<>>(opts, func);
-                run_packer(packer, layout, begin(nets), end(nets), out, num_thrds, verbose_level);
-
-            } else if (method == "lcs") {
-                cout << "Method: LCS" << "\n";
-                auto packer = makeSaPacker<LcsPackGenerator<>>(opts, func);
-                run_packer(packer, layout, begin(nets), end(nets), out, num_thrds, verbose_level);
-                
-            } else {
-                assert(false);
-            }
-        }
+            if (max_extent <= numeric_limits<std::int32_t>::max())
+                run_method_with_coordinate<std::int32_t>(layout.size(), method, opts, func,
+                    layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+            else
+                run_method_with_coordinate<std::int64_t>(layout.size(), method, opts, func,
+                    layout, first_line, last_line, out, num_thrds, verbose_level, flags);
+        };
+        auto run = [&](const auto &func, auto first_line, auto last_line) {
+            using func_t = std::decay_t<decltype(func)>;
+            if (has_outline)
+                run_with(SaPackerBase::fixed_outline_energy_function<func_t>(func, 
+                    outline_width, outline_height), first_line, last_line);
+            else
+                run_with(func, first_line, last_line);
+        };
+        // Wirelength is updated by moved cells only if asked and not ignored
+        if (!is_two_pin)
+            run(SaPackerBase::hpwl_energy_function(alpha), netlist.begin(), netlist.end());
+        else if (incremental_wirelength && alpha < 1)
+            run(SaPackerBase::incremental_energy_function(alpha), nets.begin(), nets.end());
+        else
+            run(SaPackerBase::default_energy_function(alpha), nets.begin(), nets.end());
 
     } catch (std::exception &e) {
         cout << e.what() << "\n";
@@ -183,4 +634,4 @@ int main(int argc, char **argv) {
     }
     
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
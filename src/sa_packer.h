@@ -2,64 +2,723 @@
 // Author: LYL (Aureliano Lee)
 
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <numeric>
 #include <random>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 #include <boost/container/pmr/polymorphic_allocator.hpp>
 #include <boost/container/pmr/unsynchronized_pool_resource.hpp>
 #include "layout.h"
+#include "netlist.h"
 #include "pack_generator.h"
+#include "random_engine.h"
 
 namespace rect_packing {
+    namespace detail {
+        // Sum of |(2 pos[j] + len[j]) - (2 pos[i] + len[i])| over nets (i, j) 
+        // of [first, first + n) and [second, second + n).
+        template<typename Coord>
+        area_type_for<Coord> sum_twice_distances(const Coord *pos, const Coord *len,
+            const std::uint32_t *first, const std::uint32_t *second, std::size_t n) noexcept {
+            using area_type = area_type_for<Coord>;
+            area_type twice = 0;
+            for (std::size_t k = 0; k != n; ++k) {
+                auto c0 = (area_type(pos[first[k]]) << 1) + len[first[k]];
+                auto c1 = (area_type(pos[second[k]]) << 1) + len[second[k]];
+                twice += std::abs(c1 - c0);
+            }
+            return twice;
+        }
+
+        // As above, which gathers 8 nets at a time with AVX2 and sums in 
+        // 64-bit lanes. Indices must be less than 2^31.
+        inline std::int64_t sum_twice_distances(const std::int32_t *pos, 
+            const std::int32_t *len, const std::uint32_t *first, 
+            const std::uint32_t *second, std::size_t n) noexcept {
+            std::int64_t twice = 0;
+            std::size_t k = 0;
+#if defined(__AVX2__)
+            const auto zero = _mm256_setzero_si256();
+            auto acc = zero;
+            // Twice the centers difference of 4 nets in 64-bit lanes
+            auto twice_diff = [&](__m128i p0, __m128i l0, __m128i p1, __m128i l1) {
+                auto dp = _mm256_sub_epi64(_mm256_cvtepi32_epi64(p1), _mm256_cvtepi32_epi64(p0));
+                auto dl = _mm256_sub_epi64(_mm256_cvtepi32_epi64(l1), _mm256_cvtepi32_epi64(l0));
+                auto d = _mm256_add_epi64(_mm256_slli_epi64(dp, 1), dl);
+                auto sign = _mm256_cmpgt_epi64(zero, d);
+                return _mm256_sub_epi64(_mm256_xor_si256(d, sign), sign);
+            };
+            for (; k + 8 <= n; k += 8) {
+                auto i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + k));
+                auto i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(second + k));
+                auto p0 = _mm256_i32gather_epi32(pos, i0, 4);
+                auto l0 = _mm256_i32gather_epi32(len, i0, 4);
+                auto p1 = _mm256_i32gather_epi32(pos, i1, 4);
+                auto l1 = _mm256_i32gather_epi32(len, i1, 4);
+                acc = _mm256_add_epi64(acc, twice_diff(_mm256_castsi256_si128(p0), 
+                    _mm256_castsi256_si128(l0), _mm256_castsi256_si128(p1),
+                    _mm256_castsi256_si128(l1)));
+                acc = _mm256_add_epi64(acc, twice_diff(_mm256_extracti128_si256(p0, 1),
+                    _mm256_extracti128_si256(l0, 1), _mm256_extracti128_si256(p1, 1),
+                    _mm256_extracti128_si256(l1, 1)));
+            }
+            alignas(32) std::int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+            twice = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+            for (; k != n; ++k) {
+                auto c0 = (std::int64_t(pos[first[k]]) << 1) + len[first[k]];
+                auto c1 = (std::int64_t(pos[second[k]]) << 1) + len[second[k]];
+                twice += std::abs(c1 - c0);
+            }
+            return twice;
+        }
+    }
+
+    namespace detail {
+        // Tracks the best state of a generator lazily. Instead of copying the
+        // generator on each new best, the moves accepted since the snapshot
+        // are journaled, and those leading to the best state are replayed
+        // onto the snapshot when it is needed. Once the journal is full, it
+        // is replayed and dropped, and the next new best is copied instead.
+        template<typename Generator>
+        class BestStateTracker {
+        public:
+            using generator_t = Generator;
+            using change_record_t = typename generator_t::change_record_t;
+
+            // Allocates for generators like gen, and snapshots it.
+            void reset(const generator_t &gen) {
+                _best = gen;
+                _journal.clear();
+                _journal.reserve(std::max<std::size_t>(gen.size(), 64));
+                _best_end = 0;
+                _is_tracking = false;
+            }
+
+            // Snapshots the state of gen as the best, which gen may leave 
+            // other than by moves (e.g. by shuffle).
+            void assign(const generator_t &gen) {
+                unguarded_copy_generator(gen, _best);
+                _journal.clear();
+                _best_end = 0;
+                _is_tracking = false;
+            }
+
+            // Records the move gen has just made and kept.
+            void push(const generator_t &gen) {
+                if (!_is_tracking)
+                    return;
+                if (_journal.size() == _journal.capacity()) {
+                    _replay();
+                    _journal.clear();
+                    _is_tracking = false;
+                    return;
+                }
+                _journal.push_back(gen.last_change());
+            }
+
+            // Marks the current state of gen as the best.
+            void mark(const generator_t &gen) {
+                if (_is_tracking) {
+                    _best_end = _journal.size();
+                } else {
+                    unguarded_copy_generator(gen, _best);
+                    _journal.clear();
+                    _best_end = 0;
+                    _is_tracking = true;
+                }
+            }
+
+            // The best state.
+            const generator_t &best() {
+                _replay();
+                return _best;
+            }
+
+            // Keeps the best state, and stops tracking the generator, which 
+            // has left its state other than by moves.
+            void detach() {
+                _replay();
+                _journal.clear();
+                _is_tracking = false;
+            }
+
+            // Copies the best state to gen, which is tracked from then on.
+            void restore(generator_t &gen) {
+                unguarded_copy_generator(best(), gen);
+                _journal.clear();
+                _is_tracking = true;
+            }
+
+        private:
+            // Replays the moves to the best state, and drops them.
+            void _replay() {
+                for (std::size_t k = 0; k != _best_end; ++k)
+                    _best.redo(_journal[k]);
+                _journal.erase(_journal.begin(), _journal.begin() + _best_end);
+                _best_end = 0;
+            }
+
+            generator_t _best;
+            std::vector<change_record_t> _journal;  // Moves since _best
+            std::size_t _best_end = 0;  // Moves [0, _best_end) lead to the best
+            bool _is_tracking = false;  // Whether _journal leads to the generator
+        };
+
+        // Reusable barrier of count threads. The last thread to arrive runs
+        // the completion before the others are released.
+        class CyclicBarrier {
+        public:
+            explicit CyclicBarrier(std::size_t count) : _count(count) { }
+
+            template<typename Fn>
+            void arrive_and_wait(Fn &&completion) {
+                std::unique_lock<std::mutex> lk(_mutex);
+                auto phase = _phase;
+                if (++_num_arrived == _count) {
+                    std::forward<Fn>(completion)();
+                    _num_arrived = 0;
+                    ++_phase;
+                    lk.unlock();
+                    _cond.notify_all();
+                    return;
+                }
+                _cond.wait(lk, [&] { return _phase != phase; });
+            }
+
+        private:
+            std::mutex _mutex;
+            std::condition_variable _cond;
+            std::size_t _count, _num_arrived = 0, _phase = 0;
+        };
+
+        // Lock-free single-slot mailbox from one writer to one reader by 
+        // triple buffering. The writer fills write_slot() and posts it; the 
+        // reader takes the latest post, if any, and reads it in read_slot().
+        // Neither blocks or allocates, and slots are never shared.
+        template<typename Ty>
+        class SingleSlotMailbox {
+        public:
+            explicit SingleSlotMailbox(const Ty &value = Ty()) :
+                _slots{ value, value, value } { }
+
+            Ty &write_slot() noexcept {
+                return _slots[_write_index];
+            }
+
+            void post() noexcept {
+                auto old = _middle.exchange(_write_index | _fresh, std::memory_order_acq_rel);
+                _write_index = old & _index_mask;
+            }
+
+            // Takes the latest post. Returns whether there is a new one.
+            bool take() noexcept {
+                if (!(_middle.load(std::memory_order_relaxed) & _fresh))
+                    return false;
+                auto old = _middle.exchange(_read_index, std::memory_order_acq_rel);
+                _read_index = old & _index_mask;
+                return true;
+            }
+
+            const Ty &read_slot() const noexcept {
+                return _slots[_read_index];
+            }
+
+        private:
+            static constexpr unsigned _index_mask = 3, _fresh = 4;
+
+            Ty _slots[3];
+            unsigned _write_index = 0, _read_index = 1;   // Owned by each side
+            std::atomic<unsigned> _middle{ 2 };
+        };
+    }
+
     // Wirelength.
-    template<typename Alloc, typename FwdIt>
-    double sum_manhattan_distances(const Layout<Alloc> &layout,
+    template<typename Alloc, typename Coord, typename FwdIt>
+    double sum_manhattan_distances(const Layout<Alloc, Coord> &layout,
         FwdIt first, FwdIt last) {
         using namespace std;
-        int64_t twice = 0;
+        using area_type = typename Layout<Alloc, Coord>::area_type;
+        area_type twice = 0;
         for (auto i = first; i != last; ++i) {
-            auto c0 = (layout.x()[get<0>(*i)] << 1) + layout.widths()[get<0>(*i)];
-            auto c1 = (layout.x()[get<1>(*i)] << 1) + layout.widths()[get<1>(*i)];
+            auto c0 = (area_type(layout.x()[get<0>(*i)]) << 1) + layout.widths()[get<0>(*i)];
+            auto c1 = (area_type(layout.x()[get<1>(*i)]) << 1) + layout.widths()[get<1>(*i)];
             twice += abs(c1 - c0);
         }
         for (auto i = first; i != last; ++i) {
-            auto c0 = (layout.y()[get<0>(*i)] << 1) + layout.heights()[get<0>(*i)];
-            auto c1 = (layout.y()[get<1>(*i)] << 1) + layout.heights()[get<1>(*i)];
+            auto c0 = (area_type(layout.y()[get<0>(*i)]) << 1) + layout.heights()[get<0>(*i)];
+            auto c1 = (area_type(layout.y()[get<1>(*i)]) << 1) + layout.heights()[get<1>(*i)];
             twice += abs(c1 - c0);
         }
         return twice / 2.0;
     }
 
-    // Default packing cost.
-    template<typename Alloc, typename FwdIt>
-    double packing_cost(const Layout<Alloc> &layout, FwdIt first, FwdIt last,
-        int w, int h, double alpha) {
-        auto area = w * h;
+    // Wirelength of nets [first, last) of the same TwoPinNetlist, computed
+    // by the SIMD kernel on 32-bit coordinates.
+    template<typename Alloc, typename Coord>
+    double sum_manhattan_distances(const Layout<Alloc, Coord> &layout,
+        TwoPinNetlist::const_iterator first, TwoPinNetlist::const_iterator last) {
+        if (first == last)
+            return 0;
+        const auto &nets = first.netlist();
+        const auto n = static_cast<std::size_t>(last - first);
+        auto net_first = nets.firsts().data() + first.index();
+        auto net_second = nets.seconds().data() + first.index();
+        typename Layout<Alloc, Coord>::area_type twice;
+        // Gathers take signed 32-bit indices
+        if (layout.size() <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+            twice = detail::sum_twice_distances(layout.x().data(), layout.widths().data(),
+                net_first, net_second, n);
+            twice += detail::sum_twice_distances(layout.y().data(), layout.heights().data(),
+                net_first, net_second, n);
+        } else {
+            twice = detail::sum_twice_distances<Coord>(layout.x().data(), 
+                layout.widths().data(), net_first, net_second, n);
+            twice += detail::sum_twice_distances<Coord>(layout.y().data(), 
+                layout.heights().data(), net_first, net_second, n);
+        }
+        return twice / 2.0;
+    }
+
+    // Default packing cost. The area is computed in area_type, which does not
+    // overflow for Coord of 32 bits.
+    template<typename Alloc, typename Coord, typename FwdIt>
+    double packing_cost(const Layout<Alloc, Coord> &layout, FwdIt first, FwdIt last,
+        Coord w, Coord h, double alpha) {
+        using area_type = typename Layout<Alloc, Coord>::area_type;
+        auto area = static_cast<area_type>(w) * h;
         auto len = sum_manhattan_distances(layout, first, last);
         return alpha * area + (1 - alpha) * len;
     }
 
+    // Half-perimeter wirelength of nets [first, last), each of which is a 
+    // range of pins (e.g. Netlist::net_view).
+    template<typename Alloc, typename Coord, typename FwdIt>
+    double sum_half_perimeters(const Layout<Alloc, Coord> &layout,
+        FwdIt first, FwdIt last) {
+        using namespace std;
+        using area_type = typename Layout<Alloc, Coord>::area_type;
+        area_type twice = 0;
+        for (auto i = first; i != last; ++i) {
+            auto &&net = *i;
+            if (begin(net) == end(net))
+                continue;
+            auto p0 = *begin(net);
+            area_type x_lo = (area_type(layout.x()[p0]) << 1) + layout.widths()[p0], x_hi = x_lo;
+            area_type y_lo = (area_type(layout.y()[p0]) << 1) + layout.heights()[p0], y_hi = y_lo;
+            for (auto p : net) {
+                auto cx = (area_type(layout.x()[p]) << 1) + layout.widths()[p];
+                auto cy = (area_type(layout.y()[p]) << 1) + layout.heights()[p];
+                x_lo = min(x_lo, cx);
+                x_hi = max(x_hi, cx);
+                y_lo = min(y_lo, cy);
+                y_hi = max(y_hi, cy);
+            }
+            twice += (x_hi - x_lo) + (y_hi - y_lo);
+        }
+        return twice / 2.0;
+    }
+
+    // packing_cost with half-perimeter wirelength of nets [first, last).
+    template<typename Alloc, typename Coord, typename FwdIt>
+    double hpwl_packing_cost(const Layout<Alloc, Coord> &layout, FwdIt first, 
+        FwdIt last, Coord w, Coord h, double alpha) {
+        using area_type = typename Layout<Alloc, Coord>::area_type;
+        auto area = static_cast<area_type>(w) * h;
+        auto len = sum_half_perimeters(layout, first, last);
+        return alpha * area + (1 - alpha) * len;
+    }
+
     // Base of SaPacker with default types.
     struct SaPackerBase {
+        // Width from which alpha * area + (1 - alpha) * wirelength is at least
+        // max_energy, given that the packing is at least min_height high.
+        static double area_reject_width(double alpha, double max_energy, 
+            double min_height) noexcept {
+            if (alpha <= 0 || min_height <= 0)
+                return std::numeric_limits<double>::infinity();
+            return max_energy / (alpha * min_height);
+        }
+
         // Evaluation function (packing_cost with binded alpha). 
         struct default_energy_function {
             default_energy_function() :
                 default_energy_function(1.0) { }
             default_energy_function(double alpha) : alpha(alpha) {}
 
-            template<typename Alloc, typename FwdIt>
-            double operator()(const Layout<Alloc> &layout, FwdIt first,
-                FwdIt last, int w, int h) const {
+            template<typename Alloc, typename Coord, typename FwdIt>
+            double operator()(const Layout<Alloc, Coord> &layout, FwdIt first,
+                FwdIt last, Coord w, Coord h) const {
                 return packing_cost(layout, first, last, w, h, alpha);
             }
 
+            // Width from which the energy is at least max_energy.
+            double reject_width(double max_energy, double min_height) const noexcept {
+                return area_reject_width(alpha, max_energy, min_height);
+            }
+
             double alpha;
         };
 
+        // Machinery shared by the stateful wirelength functions below, which
+        // derive from it as Derived: centers of cells, the CSR index of cells
+        // to nets, the lengths of nets and the journals of the last evaluation.
+        // Derived keeps its nets and provides _update_net(k), which refreshes
+        // what it caches of net k from the centers, and _net_length(k), twice
+        // the length of net k. Meets the concept of stateful energy function:
+        //  reset(layout, first, last) evaluates layout from scratch;
+        //  (layout, first, last, w, h, moved_first, moved_last) evaluates 
+        //      layout that differs from the last one in moved cells only;
+        //  rollback() restores the evaluation before the last one.
+        template<typename Derived>
+        class incremental_wirelength_function {
+        public:
+            incremental_wirelength_function(double alpha) : alpha(alpha) {}
+
+            // Evaluates layout, which differs from the last evaluated one 
+            // in cells [moved_first, moved_last) only.
+            template<typename Alloc, typename Coord, typename FwdIt, typename InIt>
+            double operator()(const Layout<Alloc, Coord> &layout, FwdIt,
+                FwdIt, Coord w, Coord h, InIt moved_first, InIt moved_last) {
+                using area_type = typename Layout<Alloc, Coord>::area_type;
+                _cell_journal.clear();
+                _net_journal.clear();
+                _last_sum = _sum;
+                ++_stamp;
+                // Cells restored by rollback may differ from layout as well
+                for (auto c : _dirty_cells)
+                    _touch_cell(layout, c);
+                _dirty_cells.clear();
+                for (; moved_first != moved_last; ++moved_first)
+                    _touch_cell(layout, static_cast<std::size_t>(*moved_first));
+                for (const auto &e : _net_journal) {
+                    _derived()._update_net(e.first);
+                    auto len = _derived()._net_length(e.first);
+                    _lengths[e.first] = len;
+                    _sum += len - e.second;
+                }
+                auto area = static_cast<area_type>(w) * h;
+                return alpha * area + (1 - alpha) * (_sum / 2.0);
+            }
+
+            // Restores the evaluation before the last one. One-shot.
+            void rollback() {
+                for (auto i = _cell_journal.crbegin(); i != _cell_journal.crend(); ++i) {
+                    _x[i->cell] = i->x;
+                    _y[i->cell] = i->y;
+                    _dirty_cells.push_back(i->cell);
+                }
+                for (auto i = _net_journal.crbegin(); i != _net_journal.crend(); ++i) {
+                    _lengths[i->first] = i->second;
+                    _derived()._update_net(i->first);
+                }
+                _sum = _last_sum;
+                _cell_journal.clear();
+                _net_journal.clear();
+            }
+
+            // Twice the wirelength of the last evaluation.
+            std::int64_t twice_wirelength() const noexcept {
+                return _sum;
+            }
+
+            // Width from which the energy is at least max_energy.
+            double reject_width(double max_energy, double min_height) const noexcept {
+                return area_reject_width(alpha, max_energy, min_height);
+            }
+
+            double alpha;
+
+        protected:
+            struct cell_record_t {
+                std::size_t cell;
+                std::int64_t x, y;
+            };
+
+            Derived &_derived() noexcept {
+                return static_cast<Derived &>(*this);
+            }
+
+            // Indexes num_nets nets by the num_cells cells of their pins, 
+            // where pins(k) gives the range of pins of net k, and evaluates
+            // layout from scratch.
+            template<typename Alloc, typename Coord, typename Pins>
+            void _reset(const Layout<Alloc, Coord> &layout, std::size_t num_nets, 
+                Pins pins) {
+                using namespace std;
+                const auto sz = layout.size();
+
+                // Counting sort of pins by cells
+                _offsets.assign(sz + 1, 0);
+                for (size_t k = 0; k != num_nets; ++k)
+                    for (auto c : pins(k))
+                        ++_offsets[c + 1];
+                partial_sum(_offsets.begin(), _offsets.end(), _offsets.begin());
+                _cell_nets.resize(_offsets.back());
+                vector<size_t> next(_offsets.cbegin(), _offsets.cend() - 1);
+                for (size_t k = 0; k != num_nets; ++k)
+                    for (auto c : pins(k))
+                        _cell_nets[next[c]++] = k;
+                // Nets with repeated pins are listed once per cell
+                for (size_t c = 0; c != sz; ++c) {
+                    auto first_net = _cell_nets.begin() + _offsets[c];
+                    auto last_net = _cell_nets.begin() + _offsets[c + 1];
+                    fill(unique(first_net, last_net), last_net, num_nets);
+                }
+                _num_nets = num_nets;
+
+                _x.resize(sz);
+                _y.resize(sz);
+                for (size_t c = 0; c != sz; ++c)
+                    _update_cell(layout, c);
+                _lengths.resize(num_nets);
+                _sum = 0;
+                for (size_t k = 0; k != num_nets; ++k) {
+                    _derived()._update_net(k);
+                    _lengths[k] = _derived()._net_length(k);
+                    _sum += _lengths[k];
+                }
+                _net_stamps.assign(num_nets + 1, 0);
+                _stamp = 0;
+                _cell_journal.clear();
+                _net_journal.clear();
+                _dirty_cells.clear();
+            }
+
+            // Keeps twice the center of cell c.
+            template<typename Alloc, typename Coord>
+            void _update_cell(const Layout<Alloc, Coord> &layout, std::size_t c) {
+                _x[c] = (std::int64_t(layout.x()[c]) << 1) + layout.widths()[c];
+                _y[c] = (std::int64_t(layout.y()[c]) << 1) + layout.heights()[c];
+            }
+
+            // Journals cell c and its nets if c has moved.
+            template<typename Alloc, typename Coord>
+            void _touch_cell(const Layout<Alloc, Coord> &layout, std::size_t c) {
+                cell_record_t rec{ c, _x[c], _y[c] };
+                _update_cell(layout, c);
+                if (_x[c] == rec.x && _y[c] == rec.y)
+                    return;
+                _cell_journal.push_back(rec);
+                for (auto k = _offsets[c]; k != _offsets[c + 1]; ++k) {
+                    auto net = _cell_nets[k];
+                    if (_net_stamps[net] != _stamp) {
+                        _net_stamps[net] = _stamp;
+                        if (net != _num_nets)
+                            _net_journal.emplace_back(net, _lengths[net]);
+                    }
+                }
+            }
+
+            std::size_t _num_nets = 0;
+            std::vector<std::size_t> _offsets, _cell_nets;  // CSR of cells to nets
+            std::vector<std::int64_t> _x, _y;       // Twice the centers
+            std::vector<std::int64_t> _lengths;     // Twice the net lengths
+            std::int64_t _sum = 0, _last_sum = 0;
+            std::vector<std::size_t> _net_stamps;   // Nets journaled at _stamp
+            std::size_t _stamp = 0;
+            std::vector<cell_record_t> _cell_journal;
+            std::vector<std::pair<std::size_t, std::int64_t>> _net_journal;
+            std::vector<std::size_t> _dirty_cells;
+        };
+
+        // packing_cost with binded alpha, which keeps the wirelength of the 
+        // last layout and updates it by the nets of moved cells only. Meets 
+        // the concept of stateful energy function.
+        class incremental_energy_function : 
+            public incremental_wirelength_function<incremental_energy_function> {
+            friend class incremental_wirelength_function<incremental_energy_function>;
+
+        public:
+            incremental_energy_function() :
+                incremental_energy_function(1.0) { }
+            incremental_energy_function(double alpha) : 
+                incremental_wirelength_function(alpha) {}
+
+            // Builds the index of nets [first, last), and evaluates layout.
+            template<typename Alloc, typename Coord, typename FwdIt>
+            void reset(const Layout<Alloc, Coord> &layout, FwdIt first, FwdIt last) {
+                using namespace std;
+                _net_cells.clear();
+                for (auto i = first; i != last; ++i) {
+                    _net_cells.push_back(get<0>(*i));
+                    _net_cells.push_back(get<1>(*i));
+                }
+                _reset(layout, _net_cells.size() / 2, [this](size_t k) {
+                    return Netlist::net_view(_net_cells.data() + 2 * k, 
+                        _net_cells.data() + 2 * k + 2);
+                });
+            }
+
+        protected:
+            // Net k caches nothing but its length.
+            void _update_net(std::size_t) const noexcept { }
+
+            // Twice the Manhattan length of net k.
+            std::int64_t _net_length(std::size_t k) const noexcept {
+                auto c0 = _net_cells[2 * k], c1 = _net_cells[2 * k + 1];
+                return std::abs(_x[c1] - _x[c0]) + std::abs(_y[c1] - _y[c0]);
+            }
+
+            std::vector<std::size_t> _net_cells;    // Pairs of cells
+        };
+
+        // hpwl_packing_cost with binded alpha for multi-pin nets, i.e. ranges
+        // of pins. It keeps the bounding boxes of nets in SoA form and
+        // recomputes the nets of moved cells only. Meets the concept of 
+        // stateful energy function.
+        class hpwl_energy_function : 
+            public incremental_wirelength_function<hpwl_energy_function> {
+            friend class incremental_wirelength_function<hpwl_energy_function>;
+
+        public:
+            hpwl_energy_function() :
+                hpwl_energy_function(1.0) { }
+            hpwl_energy_function(double alpha) : incremental_wirelength_function(alpha) {}
+
+            // Copies nets [first, last) and evaluates layout.
+            template<typename Alloc, typename Coord, typename FwdIt>
+            void reset(const Layout<Alloc, Coord> &layout, FwdIt first, FwdIt last) {
+                using namespace std;
+                _nets.clear();
+                for (auto i = first; i != last; ++i) {
+                    auto &&net = *i;
+                    _nets.push(begin(net), end(net));
+                }
+                const auto num_nets = _nets.size();
+                _x_lo.resize(num_nets);
+                _x_hi.resize(num_nets);
+                _y_lo.resize(num_nets);
+                _y_hi.resize(num_nets);
+                _reset(layout, num_nets, [this](size_t k) { return _nets.net(k); });
+            }
+
+        protected:
+            // Recomputes the bounding box of net k.
+            void _update_net(std::size_t k) noexcept {
+                using namespace std;
+                auto net = _nets.net(k);
+                if (net.size() == 0) {
+                    _x_lo[k] = _x_hi[k] = _y_lo[k] = _y_hi[k] = 0;
+                    return;
+                }
+                auto p0 = *net.begin();
+                int64_t x_lo = _x[p0], x_hi = x_lo, y_lo = _y[p0], y_hi = y_lo;
+                for (auto p : net) {
+                    x_lo = min(x_lo, _x[p]);
+                    x_hi = max(x_hi, _x[p]);
+                    y_lo = min(y_lo, _y[p]);
+                    y_hi = max(y_hi, _y[p]);
+                }
+                _x_lo[k] = x_lo;
+                _x_hi[k] = x_hi;
+                _y_lo[k] = y_lo;
+                _y_hi[k] = y_hi;
+            }
+
+            // Twice the half perimeter of net k.
+            std::int64_t _net_length(std::size_t k) const noexcept {
+                return (_x_hi[k] - _x_lo[k]) + (_y_hi[k] - _y_lo[k]);
+            }
+
+            Netlist _nets;
+            std::vector<std::int64_t> _x_lo, _x_hi, _y_lo, _y_hi;  // Bounding boxes
+        };
+
+        // Energy function EFunc (one of the above) of packings in a fixed
+        // outline of width x height. Packings sticking out are penalized by 
+        // penalty times the area of the strips beyond the sides of the outline,
+        // i.e. (w - width) * height for the right side and (h - height) * width
+        // for the top. Stateful iff EFunc is.
+        template<typename EFunc>
+        class fixed_outline_energy_function {
+        public:
+            using base_function_t = EFunc;
+
+            fixed_outline_energy_function() = default;
+            fixed_outline_energy_function(const base_function_t &func, double width,
+                double height, double penalty = 10.0) :
+                width(width), height(height), penalty(penalty), _func(func) { }
+
+            const base_function_t &base() const noexcept {
+                return _func;
+            }
+
+            // Whether a packing of w x h fits in the outline.
+            template<typename Coord>
+            bool is_feasible(Coord w, Coord h) const noexcept {
+                return w <= width && h <= height;
+            }
+
+            // Penalty of a packing of w x h.
+            template<typename Coord>
+            double violation(Coord w, Coord h) const noexcept {
+                return penalty * (std::max(w - width, 0.0) * height + 
+                    std::max(h - height, 0.0) * width);
+            }
+
+            template<typename Alloc, typename Coord, typename FwdIt>
+            double operator()(const Layout<Alloc, Coord> &layout, FwdIt first,
+                FwdIt last, Coord w, Coord h) const {
+                return _func(layout, first, last, w, h) + violation(w, h);
+            }
+
+            template<typename Alloc, typename Coord, typename FwdIt>
+            void reset(const Layout<Alloc, Coord> &layout, FwdIt first, FwdIt last) {
+                _func.reset(layout, first, last);
+            }
+
+            template<typename Alloc, typename Coord, typename FwdIt, typename InIt>
+            double operator()(const Layout<Alloc, Coord> &layout, FwdIt first,
+                FwdIt last, Coord w, Coord h, InIt moved_first, InIt moved_last) {
+                return _func(layout, first, last, w, h, moved_first, moved_last) + 
+                    violation(w, h);
+            }
+
+            void rollback() {
+                _func.rollback();
+            }
+
+            // Width from which the energy is at least max_energy. Beyond the
+            // outline, the penalty grows by penalty * height per unit width, 
+            // so with a large penalty candidates are rejected soon after their
+            // x pass leaves the outline.
+            double reject_width(double max_energy, double min_height) const noexcept {
+                auto a = _func.alpha * min_height;  // Area per unit width
+                auto b = penalty * height;          // Penalty per unit width beyond
+                if (a * width >= max_energy)
+                    return area_reject_width(_func.alpha, max_energy, min_height);
+                if (a + b <= 0)
+                    return std::numeric_limits<double>::infinity();
+                return (max_energy + b * width) / (a + b);
+            }
+
+            double width = std::numeric_limits<double>::infinity(),
+                height = std::numeric_limits<double>::infinity();
+            double penalty = 10.0;
+
+        private:
+            base_function_t _func;
+        };
+
         // Options for simulated annealing.
         struct options_t {
             options_t() = default;
@@ -77,8 +736,129 @@ namespace rect_packing {
             double restart_ratio = 2;
             double stopping_accepting_probability = 0.05;
         };
+
+        // Population update between temperatures of the parallel policy, 
+        // which resamples the states of threads by the Boltzmann distribution
+        // and runs no genetic generation.
+        struct boltzmann_resampling {
+            static constexpr std::size_t num_generations = 0;
+            static constexpr double crossover_probability = 0;
+
+            template<typename Generator, typename Eng>
+            void breed(const Generator &, const Generator &, Generator &, Eng &) const { }
+        };
+
+        // Population update running num_generations genetic generations 
+        // after each temperature. In a generation each thread draws a parent
+        // by the Boltzmann distribution, and with crossover_probability a mate
+        // too, and breeds and evaluates their child in parallel.
+        struct genetic_population_update {
+            using crossover_t = PackGeneratorBase::crossover_t;
+
+            explicit genetic_population_update(crossover_t kind = crossover_t::pmx,
+                std::size_t gens = 1, double p_crossover = 0.8) : 
+                crossover(kind), num_generations(gens), crossover_probability(p_crossover) { }
+
+            // Writes a child of lhs and rhs to child.
+            template<typename Generator, typename Eng>
+            void breed(const Generator &lhs, const Generator &rhs, Generator &child, 
+                Eng &eng) const {
+                child.crossover(lhs, rhs, crossover, eng);
+            }
+
+            crossover_t crossover;
+            std::size_t num_generations;
+            double crossover_probability;
+        };
+
+        // Progress of a sequential run watched by other threads, e.g. of a 
+        // portfolio. After each temperature the run publishes its min energy
+        // and the number of temperatures done, and it stops with its best 
+        // solution once cancelled is set.
+        struct progress_t {
+            std::atomic<double> min_energy{ std::numeric_limits<double>::max() };
+            std::atomic<std::size_t> num_temperatures{ 0 };
+            std::atomic<bool> cancelled{ false };
+        };
+
+        // Migration of a sequential run, e.g. between processes. Every 
+        // interval temperatures the run offers its best state and energy to
+        // exchange, which returns whether it wrote a state and its energy 
+        // from elsewhere to the last two arguments. The run continues from 
+        // that state if it is better than the current one.
+        struct migration_t {
+            using snapshot_t = PackGeneratorBase::snapshot_t;
+
+            std::size_t interval = 10;
+            std::function<bool(const snapshot_t &, double, snapshot_t &, double &)> exchange;
+        };
+
+        // Counters of the last run. Each policy sets those it keeps, and the
+        // others are 0.
+        struct statistics_t {
+            std::size_t num_restarts = 0;           // Restarts from a best state
+            std::size_t num_migrations = 0;         // States migrated in
+            std::size_t num_exchanges = 0;          // Replica exchanges done
+            std::size_t num_exchange_trials = 0;    // Replica exchanges tried
+            std::size_t num_batches = 0;            // Speculative batches evaluated
+            std::size_t num_posts = 0;              // Island bests posted or relayed
+            std::size_t num_adoptions = 0;          // Island posts adopted
+            std::size_t num_generations = 0;        // Genetic generations run
+            std::size_t num_offspring = 0;          // Children bred
+        };
     };
 
+    // Traits for energy functions, which are stateless by default.
+    template<typename EFunc>
+    struct IsStatefulEnergyFunction : public std::false_type { };
+
+    template<>
+    struct IsStatefulEnergyFunction<typename SaPackerBase::incremental_energy_function> :
+        public std::true_type { };
+
+    template<>
+    struct IsStatefulEnergyFunction<typename SaPackerBase::hpwl_energy_function> :
+        public std::true_type { };
+
+    template<typename EFunc>
+    struct IsStatefulEnergyFunction<
+        typename SaPackerBase::fixed_outline_energy_function<EFunc>> :
+        public IsStatefulEnergyFunction<EFunc> { };
+
+    // Traits for energy functions providing reject_width(max_energy, min_height),
+    // the width from which the energy is at least max_energy given that the
+    // packing is at least min_height high. SaPacker stops evaluating a move 
+    // once its width reaches that of the acceptance threshold.
+    template<typename EFunc>
+    struct IsWidthBoundedEnergyFunction : public std::false_type { };
+
+    template<>
+    struct IsWidthBoundedEnergyFunction<typename SaPackerBase::default_energy_function> :
+        public std::true_type { };
+
+    template<>
+    struct IsWidthBoundedEnergyFunction<typename SaPackerBase::incremental_energy_function> :
+        public std::true_type { };
+
+    template<>
+    struct IsWidthBoundedEnergyFunction<typename SaPackerBase::hpwl_energy_function> :
+        public std::true_type { };
+
+    template<typename EFunc>
+    struct IsWidthBoundedEnergyFunction<
+        typename SaPackerBase::fixed_outline_energy_function<EFunc>> :
+        public std::true_type { };
+
+    // Traits for energy functions providing is_feasible(w, h), for which 
+    // SaPacker reports the time to the first feasible packing accepted.
+    template<typename EFunc>
+    struct IsConstrainedEnergyFunction : public std::false_type { };
+
+    template<typename EFunc>
+    struct IsConstrainedEnergyFunction<
+        typename SaPackerBase::fixed_outline_energy_function<EFunc>> :
+        public std::true_type { };
+
     std::istream &operator>>(std::istream &in, typename SaPackerBase::options_t &opts) {
         //in >> opts.initial_simulations;
         in >> opts.initial_accepting_probability;
@@ -99,9 +879,10 @@ namespace rect_packing {
         return out;
     }
 
-    // Simulated annealing packer.
+    // Simulated annealing packer. Eng is the random engine of the annealer
+    // and its threads, on which moves and Metropolis thresholds are drawn.
     template<typename Generator, typename EFunc = 
-        typename SaPackerBase::default_energy_function>
+        typename SaPackerBase::default_energy_function, typename Eng = Xoshiro256ss>
     class SaPacker : public SaPackerBase {
         using self_t = SaPacker;
         using base_t = SaPackerBase;
@@ -111,10 +892,17 @@ namespace rect_packing {
         using typename base_t::default_energy_function;
         using generator_t = typename Generator::unbuffered_generator_t;
         using energy_function_t = EFunc;
+        using random_engine_t = Eng;
         struct sequenced_policy { };
         struct parallel_policy { };
+        struct tempering_policy { };
+        struct speculative_policy { };
+        struct island_policy { };
         static constexpr sequenced_policy seq = sequenced_policy();
         static constexpr parallel_policy par = parallel_policy();
+        static constexpr tempering_policy temper = tempering_policy();
+        static constexpr speculative_policy spec = speculative_policy();
+        static constexpr island_policy island = island_policy();
         
     protected:
         using generator_allocator_type = typename generator_t::allocator_type;
@@ -148,11 +936,46 @@ namespace rect_packing {
             return _generator;
         }
 
+        // Replaces the prototype generator, e.g. to select its evaluation 
+        // backend. Its state is reconstructed from layout on each run.
+        void set_generator(const generator_t &gen) {
+            _generator = gen;
+        }
+
+        // Reseeds the random engine, e.g. of a copy of another packer.
+        void seed(typename random_engine_t::result_type value) {
+            _eng.seed(value);
+        }
+
+        // Makes sequential runs report to progress, which must outlive them,
+        // or to none if it is null.
+        void set_progress(progress_t *progress) noexcept {
+            _progress = progress;
+        }
+
+        // Makes sequential runs migrate by migration, or not if its exchange
+        // is empty.
+        void set_migration(const migration_t &migration) {
+            _migration = migration;
+        }
+
+        // Time from the start of the last run to the first feasible packing 
+        // accepted, or duration::max() if there was none. Every packing is 
+        // feasible unless the energy function is constrained.
+        std::chrono::steady_clock::duration first_feasible_time() const noexcept {
+            return _first_feasible_time;
+        }
+
+        // Counters of the last run.
+        const statistics_t &statistics() const noexcept {
+            return _stats;
+        }
+
         // Generates the solution and writes it to layout.
-        template<typename LayoutAlloc, typename FwdIt,
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
             typename ChgDist = generator_default_change_distribution,
             typename Alloc = generator_allocator_type>
-            double operator()(Layout<LayoutAlloc> &layout, FwdIt first_line, FwdIt last_line,
+            double operator()(Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line,
                 ChgDist &&chg_dist = ChgDist(), Alloc &&alloc = Alloc(), 
                 unsigned verbose_level = 1) {
             using namespace std;
@@ -160,30 +983,43 @@ namespace rect_packing {
                 return 0;
 
             size_t num_simulations = 0;
+            const auto start_time = chrono::steady_clock::now();
+            _first_feasible_time = chrono::steady_clock::duration::max();
+            _stats = statistics_t();
+            bool found_feasible = false;
+            auto note_feasible = [&](Coord w, Coord h) {
+                if (!found_feasible && _is_feasible(_energy_func, w, h)) {
+                    found_feasible = true;
+                    _first_feasible_time = chrono::steady_clock::now() - start_time;
+                }
+            };
 
             // Deferred generator construction from layout.
             _generator.construct(layout.widths(), layout.heights(), _eng); 
-            auto best_gen = _generator;
+            _track_moved_cells(_generator);
+            detail::BestStateTracker<generator_t> best;   // Layout is packed at last
+            best.reset(_generator);
             auto res = _generator.make_resource();
             
             // Initial loop for determining starting temperature.
             auto local_layout = layout;
-            auto best_layout = layout;
             double min_energy = numeric_limits<double>().max(), 
                 max_energy = numeric_limits<double>().min();
             double curr_energy, last_energy;
             double sum_energies = 0, sum_sqrs = 0;   // For stddev
+            _reset_energy(_energy_func, local_layout, first_line, last_line);
             
             if (verbose_level) cout << "\n";
             constexpr size_t init_sims = 64;  
             for (size_t i = 0; i != init_sims; ++i) {
-                int w, h;
+                Coord w, h;
                 std::tie(w, h) = _generator(local_layout, _eng, res, chg_dist, alloc);
-                curr_energy = _energy_func(local_layout, first_line, last_line, w, h);
+                curr_energy = _evaluate(_energy_func, _generator, local_layout,
+                    first_line, last_line, w, h);
                 ++num_simulations;
+                note_feasible(w, h);
                 if (curr_energy < min_energy) {
-                    detail::unguarded_copy_layout(local_layout, best_layout);
-                    detail::unguarded_copy_generator(_generator, best_gen);
+                    best.assign(_generator);
                     min_energy = curr_energy;
                 }
                 sum_energies += curr_energy;
@@ -209,37 +1045,58 @@ namespace rect_packing {
 
             // Main simulation process.
             constexpr double temp_guard = 1.0;
-            uniform_real_distribution<> rand_double(0, 1);
-            size_t num_restarts = 0;
+            const auto min_height = _min_height(layout);
+            size_t num_restarts = 0, num_early_rejections = 0;
+            size_t num_temperatures = 0, num_migrations = 0;
+            typename migration_t::snapshot_t outgoing, incoming;
 
             for (;;) {
-                size_t num_acceptions = 0;
+                size_t num_acceptions = 0, num_evaluated = 0;
                 double my_sum_energies = 0;
 
                 for (size_t i = 0; i != _opts.simulaions_per_temperature; ++i) {
-                    int w, h;
-                    std::tie(w, h) = _generator(local_layout, _eng, res, chg_dist, alloc);
+                    // The threshold is drawn first, so that evaluation can stop
+                    // once the width tells the move is rejected
+                    auto max_energy = _draw_max_energy(curr_energy, temp, _eng);
+                    auto reject_width = _reject_width<Coord>(_energy_func, max_energy,
+                        min_height);
+                    Coord w, h;
+                    std::tie(w, h) = _generator(local_layout, _eng, res, chg_dist, alloc,
+                        reject_width);
                     ++num_simulations;
-                    auto new_energy = _energy_func(local_layout, first_line, last_line, w, h);
+                    if (w >= reject_width) {
+                        ++num_early_rejections;
+                        _credit_change(chg_dist, _generator, false, 0);
+                        _checked_undo(std::forward<ChgDist>(chg_dist));
+                        continue;
+                    }
+                    auto new_energy = _evaluate(_energy_func, _generator, local_layout,
+                        first_line, last_line, w, h);
                     my_sum_energies += new_energy;
+                    ++num_evaluated;
 
-                    if (new_energy < curr_energy ||
-                        rand_double(_eng) < exp((curr_energy - new_energy) / temp)) {
+                    _credit_change(chg_dist, _generator, new_energy < max_energy, 
+                        (curr_energy - new_energy) / temp);
+                    if (new_energy < max_energy) {
+                        note_feasible(w, h);
+                        best.push(_generator);
                         if (new_energy < min_energy) {
-                            detail::unguarded_copy_layout(local_layout, best_layout);
-                            detail::unguarded_copy_generator(_generator, best_gen);
+                            best.mark(_generator);
                             min_energy = new_energy;
                         }
                         curr_energy = new_energy;
                         ++num_acceptions;
                     } else {
                         _checked_undo(std::forward<ChgDist>(chg_dist));
+                        _undo_energy(_energy_func);
                     }
                 }
+                _end_temperature(chg_dist);
+                const auto avg_energy = _average_energy(my_sum_energies, num_evaluated, 
+                    curr_energy);
                 
                 if (verbose_level >= 2) {
-                    cout << "Temperature: " << temp << ", average energy: " <<
-                        my_sum_energies / _opts.simulaions_per_temperature <<
+                    cout << "Temperature: " << temp << ", average energy: " << avg_energy <<
                         ", acception rate: " << static_cast<double>(num_acceptions) /
                         _opts.simulaions_per_temperature << "\n";
                 }
@@ -249,14 +1106,31 @@ namespace rect_packing {
                     _opts.stopping_accepting_probability * _opts.simulaions_per_temperature ||
                     temp < temp_guard)  // Usually this doens't happen, in certain cases this is necessary
                     break;
+                if (_publish_progress(min_energy))
+                    break;
 
-                // Restart if necessary
+                // Migrate if a better state comes, or restart if necessary
                 // Note: based on average or current? (experiment shows that average-based 
                 // restart is better)
-                if (my_sum_energies / _opts.simulaions_per_temperature >
-                    _opts.restart_ratio * min_energy) {
-                    detail::unguarded_copy_layout(best_layout, local_layout);  // Not compulsory
-                    detail::unguarded_copy_generator(best_gen, _generator);
+                if (_migrate(layout, best, min_energy, curr_energy, ++num_temperatures,
+                    outgoing, incoming)) {
+                    _generator.load(incoming, layout.widths(), layout.heights());
+                    Coord w, h;
+                    std::tie(w, h) = _generator.pack(local_layout, _eng, res, alloc);
+                    curr_energy = _evaluate_from_scratch(_energy_func, _generator, local_layout,
+                        first_line, last_line, w, h);
+                    note_feasible(w, h);
+                    best.detach();
+                    if (curr_energy < min_energy) {
+                        best.mark(_generator);
+                        min_energy = curr_energy;
+                    }
+                    ++num_migrations;
+                } else if (avg_energy > _opts.restart_ratio * min_energy) {
+                    best.restore(_generator);
+                    _generator.pack(local_layout, _eng, res, alloc);
+                    _generator.reset_moved_cells();
+                    _reset_energy(_energy_func, local_layout, first_line, last_line);
                     curr_energy = min_energy;
                     ++num_restarts;
                 }
@@ -271,17 +1145,25 @@ namespace rect_packing {
                 cout << "Finishing temperature: " << temp << "\n";
                 cout << "Finishing energy: " << curr_energy << "\n";
                 cout << "Total simulations: " << num_simulations << "\n";
+                cout << "Total early rejections: " << num_early_rejections << "\n";
                 cout << "Total restarts: " << num_restarts << "\n";
+                if (_migration.exchange)
+                    cout << "Total migrations: " << num_migrations << "\n";
+                _print_first_feasible_time();
+                _print_change_distribution(chg_dist);
             }
-            layout = std::move(best_layout);
+            _stats.num_restarts = num_restarts;
+            _stats.num_migrations = num_migrations;
+            best.restore(_generator);
+            _generator.pack(layout, _eng, res, alloc);
             return min_energy;
         }
 
         // Generates the solution and writes it to layout.
-        template<typename LayoutAlloc, typename FwdIt,
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
             typename ChgDist = generator_default_change_distribution,
             typename Alloc = generator_allocator_type>
-            double operator()(sequenced_policy, Layout<LayoutAlloc> &layout, 
+            double operator()(sequenced_policy, Layout<LayoutAlloc, Coord> &layout, 
                 FwdIt first_line, FwdIt last_line,
                 ChgDist &&chg_dist = ChgDist(), Alloc &&alloc = Alloc(),
                 unsigned verbose_level = 1) {
@@ -292,10 +1174,10 @@ namespace rect_packing {
         // Generates the solution and writes it to layout.
         // When using parallel version, it is recommended to use 
         // restart_ratio = 2 + 0.3 * (n - 1) / 7 .
-        template<typename LayoutAlloc, typename FwdIt,
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
             typename ChgDist = generator_default_change_distribution,
             typename Alloc = generator_allocator_type>
-            double operator()(parallel_policy, Layout<LayoutAlloc> &layout,
+            double operator()(parallel_policy, Layout<LayoutAlloc, Coord> &layout,
                 FwdIt first_line, FwdIt last_line,
                 ChgDist &&chg_dist = ChgDist(), Alloc &&alloc = Alloc(),
                 unsigned verbose_level = 1) {
@@ -307,11 +1189,23 @@ namespace rect_packing {
         // Generates the solution and writes it to layout.
         // When using parallel version, it is recommended to use 
         // restart_ratio = 2 + 0.3 * (n - 1) / 7 .
-        template<typename LayoutAlloc, typename FwdIt,
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
             typename ChgDist, typename Alloc>
-            double operator()(parallel_policy, Layout<LayoutAlloc> &layout, 
+            double operator()(parallel_policy, Layout<LayoutAlloc, Coord> &layout, 
                 FwdIt first_line, FwdIt last_line, ChgDist &&chg_dist, Alloc &&alloc,
                 unsigned verbose_level, unsigned num_thrds) {
+            return this->operator()(parallel_policy(), layout, first_line, last_line,
+                std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc), verbose_level,
+                num_thrds, boltzmann_resampling());
+        }
+
+        // As above, with update (e.g. genetic_population_update) as the 
+        // population update between temperatures.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist, typename Alloc, typename PopUpdate>
+            double operator()(parallel_policy, Layout<LayoutAlloc, Coord> &layout, 
+                FwdIt first_line, FwdIt last_line, ChgDist &&chg_dist, Alloc &&alloc,
+                unsigned verbose_level, unsigned num_thrds, PopUpdate &&update) {
             using namespace std;
             if (layout.empty())
                 return 0;
@@ -321,28 +1215,41 @@ namespace rect_packing {
                     verbose_level);
 
             size_t num_simulations = 0;
+            const auto start_time = chrono::steady_clock::now();
+            _first_feasible_time = chrono::steady_clock::duration::max();
+            _stats = statistics_t();
+            atomic<bool> found_feasible{ false };
+            // Only the first thread finding one writes the time
+            auto note_feasible = [&](const energy_function_t &func, Coord w, Coord h) {
+                if (!found_feasible.load(memory_order_relaxed) && 
+                    _is_feasible(func, w, h) && !found_feasible.exchange(true))
+                    _first_feasible_time = chrono::steady_clock::now() - start_time;
+            };
 
             // Deferred generator construction from layout.
             _generator.construct(layout.widths(), layout.heights(), _eng);
+            _track_moved_cells(_generator);
             auto best_gen = _generator;
             auto res = _generator.make_resource();
 
-            // Initial loop for determining starting temperature.
+            // Initial loop for determining starting temperature. Layout of 
+            // best_gen is packed at last.
             auto main_layout = layout;
-            auto best_layout = layout;
-            atomic<double> min_energy = numeric_limits<double>().max();
+            double min_energy = numeric_limits<double>().max();
             double max_energy = numeric_limits<double>().min();
             double curr_energy, last_energy;
             double sum_energies = 0, sum_sqrs = 0;   // For stddev
+            _reset_energy(_energy_func, main_layout, first_line, last_line);
 
             constexpr size_t init_sims = 64;
             for (size_t i = 0; i != init_sims; ++i) {
-                int w, h;
+                Coord w, h;
                 std::tie(w, h) = _generator(main_layout, _eng, res, chg_dist, alloc);
-                curr_energy = _energy_func(main_layout, first_line, last_line, w, h);
+                curr_energy = _evaluate(_energy_func, _generator, main_layout,
+                    first_line, last_line, w, h);
                 ++num_simulations;
+                note_feasible(_energy_func, w, h);
                 if (curr_energy < min_energy) {
-                    detail::unguarded_copy_layout(main_layout, best_layout);
                     detail::unguarded_copy_generator(_generator, best_gen);
                     min_energy = curr_energy;
                 }
@@ -355,8 +1262,8 @@ namespace rect_packing {
 
             auto stddev = sqrt((sum_sqrs - sum_energies * sum_energies / init_sims) /
                 (init_sims - 1));
-            atomic<double> temp = (stddev + numeric_limits<double>().epsilon()) /
-                log(1.0 / _opts.initial_accepting_probability);
+            atomic<double> temp{ (stddev + numeric_limits<double>().epsilon()) /
+                log(1.0 / _opts.initial_accepting_probability) };
 
             if (verbose_level) {
                 cout << "\n";
@@ -376,16 +1283,36 @@ namespace rect_packing {
             const auto actual_simulations_per_temp = simulations_per_thrd * (num_thrds - 1);  
                         
             // Shared variables
-            mutex cout_mutex, best_sln_mutex, sync_mutex;
+            mutex sync_mutex;
             condition_variable ctrl_cond, feedback_cond;
             vector<bool> thrd_is_ready(num_thrds - 1, true);
             size_t num_finished_thrds = 0;
-            bool stop_simulation = false;
-            atomic<size_t> loop_num_acceptions = 0;
-            vector<generator_t> thrd_generators(num_thrds - 1, _generator);
+            bool stop_simulation = false, breeding = false;
+            atomic<size_t> loop_num_acceptions{ 0 }, num_early_rejections{ 0 }, num_offspring{ 0 };
+            const auto min_height = _min_height(layout);
+            // Each thread owns slots 2 * i and 2 * i + 1 of thrd_generators,
+            // running in one and pulling its next parent into the other. A 
+            // thread keeping its parent runs in the slot others may pull from,
+            // so no thread runs till all have pulled at pull_barrier. 
+            // restart_slot stands for best_gen. In a breeding round a thread
+            // with a mate pulls the child of its parent and mate.
+            constexpr auto restart_slot = numeric_limits<size_t>::max(), 
+                no_mate = restart_slot - 1;
+            vector<generator_t> thrd_generators(2 * (num_thrds - 1), _generator);
+            detail::CyclicBarrier pull_barrier(num_thrds - 1);
+            // Each thread tracks its own best, and they are reduced into 
+            // best_gen and min_energy at each sync point by the main thread
+            // under sync_mutex, while the threads wait. best_thrd is whose
+            // best it is, or restart_slot if none.
+            vector<detail::BestStateTracker<generator_t>> thrd_bests(num_thrds - 1);
+            vector<double> thrd_min_energies(num_thrds - 1, numeric_limits<double>().max());
+            auto best_thrd = restart_slot;
+            vector<size_t> thrd_slots(num_thrds - 1), thrd_parents(num_thrds - 1, restart_slot),
+                thrd_mates(num_thrds - 1, no_mate);
+            vector<double> thrd_parent_energies(num_thrds - 1, 0);
             vector<double> thrd_curr_energies(num_thrds - 1, curr_energy);
             vector<double> thrd_avg_energies(num_thrds - 1, 0);
-            vector<Layout<LayoutAlloc>> thrd_layouts(num_thrds - 1, main_layout);
+            vector<Layout<LayoutAlloc, Coord>> thrd_layouts(num_thrds - 1, main_layout);
             vector<decltype(res)> thrd_resources(num_thrds - 1, res);
             vector<energy_function_t> thrd_energy_funcs(num_thrds - 1, _energy_func);
             vector<decay_t<ChgDist>> thrd_chg_dists(num_thrds - 1, chg_dist);
@@ -393,71 +1320,135 @@ namespace rect_packing {
             vector<thread> thrds;
             thrds.reserve(num_thrds - 1);
             for (auto i = num_thrds - 1; i--; ) {
-                thrds.emplace_back([&, i, curr_energy] {
+                thrds.emplace_back([&, i] {
                     // No memory allocation for these stuff in the thread, so using 
                     // customized allocators is OK
                     auto &my_layout = thrd_layouts[i];   
                     auto &my_res = thrd_resources[i];  
                     auto &my_energy_func = thrd_energy_funcs[i];
                     auto &my_chg_dist = thrd_chg_dists[i];
-
-                    // Alias for clarity
-                    auto my_curr_energy = curr_energy;
+                    auto &my_best = thrd_bests[i];
+                    auto my_slot = 2 * i;
+                    double my_curr_energy = 0, my_min_energy = numeric_limits<double>().max();
+                    my_best.reset(thrd_generators[my_slot]);
+
+                    // Notes gen, which has just been pulled, in my best
+                    auto note_pulled = [&](const generator_t &gen) {
+                        my_best.detach();
+                        if (my_curr_energy < my_min_energy) {
+                            my_best.mark(gen);
+                            my_min_energy = my_curr_energy;
+                        }
+                    };
 
                     // Thread local variables
                     boost::container::pmr::unsynchronized_pool_resource my_pool_resource;
                     boost::container::pmr::polymorphic_allocator<char> my_alloc(
                         std::addressof(my_pool_resource));  // Each thread allocates its memory
-                    default_random_engine my_eng(SEQPAIR_RANDOM_SEED());
-                    uniform_real_distribution<> rand_double(0, 1);
+                    random_engine_t my_eng(SEQPAIR_RANDOM_SEED());
 
                     for (;;) {
-                        // Get my generator (this changes in different rounds)
-                        auto &my_gen = thrd_generators[i];
-                        assert(!my_gen.empty());
-
                         // Wait for continue / stop signal
+                        bool my_breeding;
                         {
                             unique_lock<mutex> lk(sync_mutex);  
                             while (!(thrd_is_ready[i] || stop_simulation))
                                 ctrl_cond.wait(lk);
                             if (stop_simulation) 
                                 break;
+                            my_breeding = breeding;
+                        }
+
+                        // Pull the parent selected by the main thread, unless 
+                        // it is my own generator, or breed it with the mate
+                        auto parent = thrd_parents[i], mate = thrd_mates[i];
+                        if (mate != no_mate) {
+                            auto &next_gen = thrd_generators[my_slot ^ 1];
+                            update.breed(parent == restart_slot ? best_gen :
+                                thrd_generators[parent], mate == restart_slot ? 
+                                best_gen : thrd_generators[mate], next_gen, my_eng);
+                            my_slot ^= 1;
+                            Coord w, h;
+                            std::tie(w, h) = next_gen.pack(my_layout, my_eng, my_res, my_alloc);
+                            my_curr_energy = _evaluate_from_scratch(my_energy_func, next_gen,
+                                my_layout, first_line, last_line, w, h);
+                            note_feasible(my_energy_func, w, h);
+                            note_pulled(next_gen);
+                            ++num_offspring;
+                        } else if (parent != my_slot) {
+                            auto &next_gen = thrd_generators[my_slot ^ 1];
+                            if (parent == restart_slot) {
+                                detail::unguarded_copy_generator(best_gen, next_gen);
+                                my_curr_energy = min_energy;
+                            } else {
+                                detail::unguarded_copy_generator(thrd_generators[parent],
+                                    next_gen);
+                                my_curr_energy = thrd_parent_energies[i];
+                            }
+                            my_slot ^= 1;
+                            next_gen.pack(my_layout, my_eng, my_res, my_alloc);
+                            _reset_energy(my_energy_func, my_layout, first_line, last_line);
+                            note_pulled(next_gen);
                         }
+                        pull_barrier.arrive_and_wait([] { });
+                        auto &my_gen = thrd_generators[my_slot];
+                        assert(!my_gen.empty());
+                        my_gen.reset_moved_cells();
 
-                        // Simulation
-                        size_t my_num_acceptions = 0;
+                        // Simulation, none in a breeding round
+                        size_t my_num_acceptions = 0, my_num_early_rejections = 0;
+                        size_t my_num_evaluated = 0;
                         double my_sum_energies = 0;
-                        for (size_t j = 0; j != simulations_per_thrd; ++j) {
-                            int w, h;
-                            std::tie(w, h) = my_gen(my_layout, my_eng, my_res, my_chg_dist, my_alloc);
-                            auto new_energy = my_energy_func(my_layout, first_line, last_line, w, h);
+                        const auto my_simulations = my_breeding ? 0 : simulations_per_thrd;
+                        for (size_t j = 0; j != my_simulations; ++j) {
+                            auto max_energy = _draw_max_energy(my_curr_energy, temp, my_eng);
+                            auto reject_width = _reject_width<Coord>(my_energy_func,
+                                max_energy, min_height);
+                            Coord w, h;
+                            std::tie(w, h) = my_gen(my_layout, my_eng, my_res, my_chg_dist,
+                                my_alloc, reject_width);
+                            if (w >= reject_width) {
+                                ++my_num_early_rejections;
+                                _credit_change(my_chg_dist, my_gen, false, 0);
+                                _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                continue;
+                            }
+                            auto new_energy = _evaluate(my_energy_func, my_gen, my_layout,
+                                first_line, last_line, w, h);
                             my_sum_energies += new_energy;
+                            ++my_num_evaluated;
+
+                            _credit_change(my_chg_dist, my_gen, new_energy < max_energy,
+                                (my_curr_energy - new_energy) / temp);
 
-                            if (new_energy < my_curr_energy ||
-                                rand_double(my_eng) < exp((my_curr_energy - new_energy) / temp)) {
-                                if (new_energy < min_energy) {
-                                    lock_guard<mutex> lg(best_sln_mutex);
-                                    if (new_energy < min_energy) {  // Double check
-                                        detail::unguarded_copy_layout(my_layout, best_layout);
-                                        detail::unguarded_copy_generator(my_gen, best_gen);
-                                        min_energy = new_energy;
-                                    }
+                            if (new_energy < max_energy) {
+                                note_feasible(my_energy_func, w, h);
+                                my_best.push(my_gen);
+                                if (new_energy < my_min_energy) {
+                                    my_best.mark(my_gen);
+                                    my_min_energy = new_energy;
                                 }
                                 my_curr_energy = new_energy;
                                 ++my_num_acceptions;
                             } else {
                                 _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                _undo_energy(my_energy_func);
                             }
                         }
+                        if (!my_breeding)
+                            _end_temperature(my_chg_dist);
 
                         // Feedback to main thread
-                        thrd_is_ready[i] = false;   // Can only be set true again by the main thread
+                        thrd_slots[i] = my_slot;
                         thrd_curr_energies[i] = my_curr_energy;
-                        thrd_avg_energies[i] = my_sum_energies / simulations_per_thrd;
+                        thrd_min_energies[i] = my_min_energy;
+                        thrd_avg_energies[i] = _average_energy(my_sum_energies,
+                            my_num_evaluated, my_curr_energy);
                         loop_num_acceptions += my_num_acceptions;
+                        num_early_rejections += my_num_early_rejections;
                         
                         unique_lock<mutex> lk(sync_mutex);
+                        thrd_is_ready[i] = false;   // Can only be set true again by the main thread
                         if (++num_finished_thrds == num_thrds - 1) {
                             lk.unlock();    // Manual unlock
                             feedback_cond.notify_one();
@@ -468,11 +1459,10 @@ namespace rect_packing {
             
             // Main thread
             constexpr double temp_guard = 1.0;
-            vector<generator_t> next_priv_generators(num_thrds - 1, _generator);
-            vector<double> next_priv_curr_energies(num_thrds - 1, 0);
             vector<double> dist_func(num_thrds - 1, 0);
             uniform_real_distribution<> random(0, 1);
-            size_t num_restarts = 0;
+            size_t num_restarts = 0, num_generations = 0;
+            size_t generation = 0;  // Breeding rounds since the last annealing one
 
             // Initial signal
             ctrl_cond.notify_all();
@@ -484,24 +1474,47 @@ namespace rect_packing {
                     unique_lock<mutex> lk(sync_mutex);
                     while ((num_finished_thrds != num_thrds - 1))
                         feedback_cond.wait(lk);
-                    num_simulations += actual_simulations_per_temp;
-
-                    if (verbose_level >= 2) {
-                        cout << "Temperature: " << temp << ", ";
-                        cout << "average energy: " << accumulate(thrd_curr_energies.cbegin(),
-                            thrd_curr_energies.cend(), 0.0) / thrd_curr_energies.size() <<
-                            ", acception rate: " << static_cast<double>(loop_num_acceptions) /
-                            actual_simulations_per_temp << "\n";
+
+                    // Reduce the bests of the threads, which are waiting
+                    auto min_thrd = static_cast<size_t>(min_element(thrd_min_energies.cbegin(),
+                        thrd_min_energies.cend()) - thrd_min_energies.cbegin());
+                    if (thrd_min_energies[min_thrd] < min_energy) {
+                        detail::unguarded_copy_generator(thrd_bests[min_thrd].best(), best_gen);
+                        min_energy = thrd_min_energies[min_thrd];
+                        best_thrd = min_thrd;
                     }
 
-                    // Termination criterion
-                    if (static_cast<double>(loop_num_acceptions) <
-                        _opts.stopping_accepting_probability * actual_simulations_per_temp ||
-                        temp < temp_guard) {
-                        stop_simulation = true;
-                        ctrl_cond.notify_all();
-                        break;
+                    if (breeding) {
+                        ++generation;
+                        ++num_generations;
+                        if (verbose_level >= 2) {
+                            cout << "Generation: " << generation << ", ";
+                            cout << "average energy: " << accumulate(thrd_curr_energies.cbegin(),
+                                thrd_curr_energies.cend(), 0.0) / thrd_curr_energies.size() << "\n";
+                        }
+                    } else {
+                        generation = 0;
+                        num_simulations += actual_simulations_per_temp;
+
+                        if (verbose_level >= 2) {
+                            cout << "Temperature: " << temp << ", ";
+                            cout << "average energy: " << accumulate(thrd_curr_energies.cbegin(),
+                                thrd_curr_energies.cend(), 0.0) / thrd_curr_energies.size() <<
+                                ", acception rate: " << static_cast<double>(loop_num_acceptions) /
+                                actual_simulations_per_temp << "\n";
+                        }
+
+                        // Termination criterion
+                        if (static_cast<double>(loop_num_acceptions) <
+                            _opts.stopping_accepting_probability * actual_simulations_per_temp ||
+                            temp < temp_guard) {
+                            stop_simulation = true;
+                            ctrl_cond.notify_all();
+                            break;
+                        }
                     }
+                    // The next round breeds till the generations are done
+                    breeding = generation < update.num_generations;
 
                     // Compute the distribution function of Boltzmann distribution
                     copy(thrd_curr_energies.data(), thrd_curr_energies.data() + 
@@ -516,9 +1529,10 @@ namespace rect_packing {
                     for (auto &e : dist_func)
                         e /= total;
 
-                    // Select generators for next round, restart if necessary
-                    for (size_t i = 0; i != thrd_generators.size(); ++i) {
-                        // Select thrd_generators[k] 
+                    // Select generators for next round, restart if necessary. 
+                    // Threads pull them themselves in parallel.
+                    for (size_t i = 0; i != thrd_parents.size(); ++i) {
+                        // Select the generator of thread k
                         auto k = lower_bound(dist_func.cbegin(), dist_func.cend(),
                             random(_eng)) - dist_func.cbegin();
                         assert(k != dist_func.size());
@@ -530,26 +1544,31 @@ namespace rect_packing {
                         // Note: base on average or current energy?
                         if (thrd_curr_energies[k] > _opts.restart_ratio * min_energy) {
                             // If average is too high, restart it
-                            detail::unguarded_copy_generator(best_gen, next_priv_generators[i]);
-                            next_priv_curr_energies[i] = min_energy;
+                            thrd_parents[i] = restart_slot;
                             ++num_restarts;
                             if (verbose_level >= 3)
                                 cout << " restarted\n";
                         } else {
                             // Average is OK, use selected generator
-                            detail::unguarded_copy_generator(thrd_generators[k], 
-                                next_priv_generators[i]);   // Cannot move here
-                            next_priv_curr_energies[i] = thrd_curr_energies[k];
+                            thrd_parents[i] = thrd_slots[k];
+                            thrd_parent_energies[i] = thrd_curr_energies[k];
                             if (verbose_level >= 3)
                                 cout << " accepted\n";
                         }
-                    }
 
-                    swap(thrd_generators, next_priv_generators);
-                    swap(thrd_curr_energies, next_priv_curr_energies);
+                        // Select a mate likewise, best_gen for a bad one
+                        thrd_mates[i] = no_mate;
+                        if (breeding && random(_eng) < update.crossover_probability) {
+                            auto m = lower_bound(dist_func.cbegin(), dist_func.cend(),
+                                random(_eng)) - dist_func.cbegin();
+                            thrd_mates[i] = thrd_curr_energies[m] > 
+                                _opts.restart_ratio * min_energy ? restart_slot : thrd_slots[m];
+                        }
+                    }
 
-                    // Drop temperature
-                    temp = temp * _opts.decreasing_ratio;
+                    // Drop temperature after the generations
+                    if (!breeding)
+                        temp = temp * _opts.decreasing_ratio;
 
                     fill(thrd_is_ready.begin(), thrd_is_ready.end(), true);
                     num_finished_thrds = 0;
@@ -571,61 +1590,1183 @@ namespace rect_packing {
                     accumulate(thrd_curr_energies.cbegin(), thrd_curr_energies.cend(), 0.0) / 
                     thrd_curr_energies.size() << "\n";
                 cout << "Total simulations: " << num_simulations << "\n";
+                cout << "Total early rejections: " << num_early_rejections << "\n";
                 cout << "Total restarts: " << num_restarts << "\n";
+                if (update.num_generations) {
+                    cout << "Total generations: " << num_generations << "\n";
+                    cout << "Total offspring: " << num_offspring << "\n";
+                }
+                if (best_thrd != restart_slot)
+                    cout << "Min energy found by thread: " << best_thrd << "\n";
+                _print_first_feasible_time();
             }
-            layout = std::move(best_layout);
+            _stats.num_restarts = num_restarts;
+            _stats.num_generations = num_generations;
+            _stats.num_offspring = num_offspring;
+            _merge_change_distributions(chg_dist, thrd_chg_dists);
+            if (verbose_level)
+                _print_change_distribution(chg_dist);
+            best_gen.pack(layout, _eng, res, alloc);
             return min_energy;
         }
 
-    protected: 
-        // Checks option.
-        bool _is_option_valid(const options_t &opts) const noexcept {
-            return opts.initial_accepting_probability > 0 &&
-                opts.initial_accepting_probability < 1 &&
-                opts.simulaions_per_temperature &&
-                opts.decreasing_ratio > 0 &&
-                opts.decreasing_ratio < 1 &&
-                opts.restart_ratio > 1 &&
-                opts.stopping_accepting_probability > 0 &&
-                opts.stopping_accepting_probability <= 1;
-        }
-
-        // Throws on invalid option.
-        const options_t &_checked_option(const options_t &opts) const {
-            if (!_is_option_valid(opts))
-                throw std::invalid_argument("Invalid argument");
-            return opts;
+        // Generates the solution by replica exchange and writes it to layout.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist = generator_default_change_distribution,
+            typename Alloc = generator_allocator_type>
+            double operator()(tempering_policy, Layout<LayoutAlloc, Coord> &layout,
+                FwdIt first_line, FwdIt last_line,
+                ChgDist &&chg_dist = ChgDist(), Alloc &&alloc = Alloc(),
+                unsigned verbose_level = 1) {
+            auto num_thrds = max(thread::hardware_concurrency(), 2u);
+            return this->operator()(tempering_policy(), layout, first_line, last_line, 
+                std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc), verbose_level, num_thrds);
         }
 
-        // Invokes generator_t::rollback and checks the return value.
-        template<typename ChgDist>
-        bool _checked_undo(ChgDist &&chg_dist) {
-            return _checked_undo(_generator, chg_dist);
-        }
+        // Generates the solution by replica exchange (parallel tempering) and 
+        // writes it to layout. Each of num_thrds threads runs a replica at a 
+        // rung of a geometric temperature ladder, with ratio decreasing_ratio 
+        // between adjacent rungs. After every round of simulaions_per_temperature
+        // moves per replica, replicas on adjacent rungs (alternately even and 
+        // odd pairs) exchange their rungs with probability 
+        // min(1, exp((1 / t0 - 1 / t1) * (e0 - e1))), where replica 0 was at t0
+        // with energy e0, and the whole ladder cools by decreasing_ratio. Only
+        // rungs are exchanged, and no state is copied. Annealing stops by the
+        // acceptance rate of the coldest rung, and each replica keeps its own
+        // best state.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist, typename Alloc>
+            double operator()(tempering_policy, Layout<LayoutAlloc, Coord> &layout, 
+                FwdIt first_line, FwdIt last_line, ChgDist &&chg_dist, Alloc &&alloc,
+                unsigned verbose_level, unsigned num_thrds) {
+            using namespace std;
+            if (layout.empty())
+                return 0;
+            if (num_thrds < 2)
+                return this->operator()(layout, first_line, last_line, 
+                    std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc),
+                    verbose_level);
 
-        // Invokes generator_t::rollback and checks the return value.
-        template<typename ChgDist>
-        bool _checked_undo(generator_t &gen, ChgDist &&chg_dist) const {
-            auto b = gen.rollback();
-            assert(detail::may_change_be_none(std::forward<ChgDist>(chg_dist)) || b);
-            return b;
-        }
+            const auto start_time = chrono::steady_clock::now();
+            _first_feasible_time = chrono::steady_clock::duration::max();
+            _stats = statistics_t();
+            atomic<bool> found_feasible{ false };
+            // Only the first thread finding one writes the time
+            auto note_feasible = [&](const energy_function_t &func, Coord w, Coord h) {
+                if (!found_feasible.load(memory_order_relaxed) && 
+                    _is_feasible(func, w, h) && !found_feasible.exchange(true))
+                    _first_feasible_time = chrono::steady_clock::now() - start_time;
+            };
 
-        // Note: actually _energy_func had better be stored in boost::compressed_pair
-        options_t _opts;
-        energy_function_t _energy_func; 
-        std::default_random_engine _eng;
-        generator_t _generator;
-    };
+            // Deferred generator construction from layout.
+            _generator.construct(layout.widths(), layout.heights(), _eng);
+            _track_moved_cells(_generator);
+            auto res = _generator.make_resource();
 
-    // Helper function for constructing SaPacker.
-    template<typename Generator, typename EFunc =
-        typename SaPackerBase::default_energy_function, typename... Types>
-        SaPacker<Generator, std::decay_t<EFunc>>
-        makeSaPacker(const typename SaPackerBase::options_t &opts =
+            // Initial loop for determining the temperature of the hottest rung.
+            auto main_layout = layout;
+            double sum_energies = 0, sum_sqrs = 0;   // For stddev
+            _reset_energy(_energy_func, main_layout, first_line, last_line);
+            constexpr size_t init_sims = 64;
+            for (size_t i = 0; i != init_sims; ++i) {
+                Coord w, h;
+                std::tie(w, h) = _generator(main_layout, _eng, res, chg_dist, alloc);
+                auto energy = _evaluate(_energy_func, _generator, main_layout,
+                    first_line, last_line, w, h);
+                note_feasible(_energy_func, w, h);
+                sum_energies += energy;
+                sum_sqrs += energy * energy;
+                _generator.shuffle(_eng);
+            }
+            auto stddev = sqrt((sum_sqrs - sum_energies * sum_energies / init_sims) /
+                (init_sims - 1));
+            auto hot_temp = (stddev + numeric_limits<double>().epsilon()) /
+                log(1.0 / _opts.initial_accepting_probability);
+
+            // Rung k is at temperature hot_temp * decreasing_ratio^k
+            vector<double> temps(num_thrds);
+            temps[0] = hot_temp;
+            for (size_t k = 1; k != num_thrds; ++k)
+                temps[k] = temps[k - 1] * _opts.decreasing_ratio;
+            if (verbose_level) {
+                cout << "\n";
+                cout << "Starting temperatures: " << temps.front() << " to " << 
+                    temps.back() << "\n";
+                cout << "Stddev: " << stddev << "\n";
+                if (verbose_level >= 2)
+                    cout << "\n";
+            }
+
+            // Shared variables, written by the last thread arriving at the barrier.
+            // Each replica runs a full temperature per round, so every rung sees
+            // as many moves as a sequential temperature, and the stopping test 
+            // of the coldest one is as strict as the sequential one.
+            const auto simulations_per_thrd = _opts.simulaions_per_temperature;
+            const auto min_height = _min_height(layout);
+            constexpr double temp_guard = 1.0;
+            vector<size_t> thrd_rungs(num_thrds), rung_thrds(num_thrds);
+            iota(thrd_rungs.begin(), thrd_rungs.end(), size_t(0));
+            iota(rung_thrds.begin(), rung_thrds.end(), size_t(0));
+            vector<double> thrd_curr_energies(num_thrds, 0), thrd_min_energies(num_thrds, 0);
+            vector<size_t> thrd_num_acceptions(num_thrds, 0);
+            vector<generator_t> thrd_generators(num_thrds, _generator);
+            vector<detail::BestStateTracker<generator_t>> thrd_bests(num_thrds);
+            vector<decay_t<ChgDist>> thrd_chg_dists(num_thrds, chg_dist);
+            atomic<size_t> num_simulations{ init_sims }, num_early_rejections{ 0 };
+            size_t num_rounds = 0, num_exchanges = 0, num_exchange_trials = 0;
+            bool stop_simulation = false;
+            uniform_real_distribution<> random(0, 1);
+
+            // Exchanges rungs and cools the ladder after each round
+            auto exchange = [&] {
+                auto cold = rung_thrds.back();
+                if (verbose_level >= 2) {
+                    cout << "Temperature: " << temps.back() << ", coldest energy: " <<
+                        thrd_curr_energies[cold] << ", acception rate: " << 
+                        static_cast<double>(thrd_num_acceptions[cold]) / 
+                        simulations_per_thrd << "\n";
+                }
+                if (static_cast<double>(thrd_num_acceptions[cold]) <
+                    _opts.stopping_accepting_probability * simulations_per_thrd ||
+                    temps.back() < temp_guard) {
+                    stop_simulation = true;
+                    return;
+                }
+
+                for (auto k = num_rounds++ % 2; k + 1 < num_thrds; k += 2) {
+                    auto i = rung_thrds[k], j = rung_thrds[k + 1];
+                    auto x = (1 / temps[k] - 1 / temps[k + 1]) *
+                        (thrd_curr_energies[i] - thrd_curr_energies[j]);
+                    ++num_exchange_trials;
+                    if (x >= 0 || random(_eng) < exp(x)) {
+                        swap(rung_thrds[k], rung_thrds[k + 1]);
+                        thrd_rungs[i] = k + 1;
+                        thrd_rungs[j] = k;
+                        ++num_exchanges;
+                    }
+                }
+                for (auto &t : temps)
+                    t *= _opts.decreasing_ratio;
+            };
+            detail::CyclicBarrier barrier(num_thrds);
+
+            vector<thread> thrds;
+            thrds.reserve(num_thrds);
+            for (auto i = num_thrds; i--; ) {
+                thrds.emplace_back([&, i] {
+                    auto &my_gen = thrd_generators[i];
+                    auto &my_best = thrd_bests[i];
+                    auto &my_chg_dist = thrd_chg_dists[i];
+                    auto my_layout = main_layout;
+                    auto my_res = res;
+                    auto my_energy_func = _energy_func;
+                    boost::container::pmr::unsynchronized_pool_resource my_pool_resource;
+                    boost::container::pmr::polymorphic_allocator<char> my_alloc(
+                        std::addressof(my_pool_resource));  // Each thread allocates its memory
+                    random_engine_t my_eng(SEQPAIR_RANDOM_SEED());
+
+                    // Each replica starts from a state of its own
+                    my_gen.shuffle(my_eng);
+                    Coord w, h;
+                    std::tie(w, h) = my_gen.pack(my_layout, my_eng, my_res, my_alloc);
+                    auto my_curr_energy = _evaluate_from_scratch(my_energy_func, my_gen,
+                        my_layout, first_line, last_line, w, h);
+                    note_feasible(my_energy_func, w, h);
+                    auto my_min_energy = my_curr_energy;
+                    my_best.reset(my_gen);
+                    my_best.mark(my_gen);
+
+                    for (;;) {
+                        auto temp = temps[thrd_rungs[i]];
+                        size_t my_num_acceptions = 0, my_num_early_rejections = 0;
+                        for (size_t j = 0; j != simulations_per_thrd; ++j) {
+                            auto max_energy = _draw_max_energy(my_curr_energy, temp, my_eng);
+                            auto reject_width = _reject_width<Coord>(my_energy_func,
+                                max_energy, min_height);
+                            std::tie(w, h) = my_gen(my_layout, my_eng, my_res, my_chg_dist,
+                                my_alloc, reject_width);
+                            if (w >= reject_width) {
+                                ++my_num_early_rejections;
+                                _credit_change(my_chg_dist, my_gen, false, 0);
+                                _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                continue;
+                            }
+                            auto new_energy = _evaluate(my_energy_func, my_gen, my_layout,
+                                first_line, last_line, w, h);
+
+                            _credit_change(my_chg_dist, my_gen, new_energy < max_energy,
+                                (my_curr_energy - new_energy) / temp);
+                            if (new_energy < max_energy) {
+                                note_feasible(my_energy_func, w, h);
+                                my_best.push(my_gen);
+                                if (new_energy < my_min_energy) {
+                                    my_best.mark(my_gen);
+                                    my_min_energy = new_energy;
+                                }
+                                my_curr_energy = new_energy;
+                                ++my_num_acceptions;
+                            } else {
+                                _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                _undo_energy(my_energy_func);
+                            }
+                        }
+                        _end_temperature(my_chg_dist);
+
+                        thrd_curr_energies[i] = my_curr_energy;
+                        thrd_min_energies[i] = my_min_energy;
+                        thrd_num_acceptions[i] = my_num_acceptions;
+                        num_simulations += simulations_per_thrd;
+                        num_early_rejections += my_num_early_rejections;
+                        barrier.arrive_and_wait(exchange);
+                        if (stop_simulation)
+                            break;
+                    }
+                }); // Thread lambda
+            }
+            for (auto &&t : thrds)
+                t.join();
+
+            // Best of the replicas
+            auto best_thrd = min_element(thrd_min_energies.cbegin(), thrd_min_energies.cend()) -
+                thrd_min_energies.cbegin();
+            if (verbose_level) {
+                cout << "\n";
+                cout << "Finishing temperatures: " << temps.front() << " to " << 
+                    temps.back() << "\n";
+                cout << "Finishing coldest energy: " << 
+                    thrd_curr_energies[rung_thrds.back()] << "\n";
+                cout << "Total simulations: " << num_simulations << "\n";
+                cout << "Total early rejections: " << num_early_rejections << "\n";
+                cout << "Total exchanges: " << num_exchanges << " of " << 
+                    num_exchange_trials << "\n";
+                _print_first_feasible_time();
+            }
+            _stats.num_exchanges = num_exchanges;
+            _stats.num_exchange_trials = num_exchange_trials;
+            _merge_change_distributions(chg_dist, thrd_chg_dists);
+            if (verbose_level)
+                _print_change_distribution(chg_dist);
+            thrd_bests[best_thrd].restore(_generator);
+            _generator.pack(layout, _eng, res, alloc);
+            return thrd_min_energies[best_thrd];
+        }
+
+        // Generates the solution with speculative moves and writes it to layout.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist = generator_default_change_distribution,
+            typename Alloc = generator_allocator_type>
+            double operator()(speculative_policy, Layout<LayoutAlloc, Coord> &layout,
+                FwdIt first_line, FwdIt last_line,
+                ChgDist &&chg_dist = ChgDist(), Alloc &&alloc = Alloc(),
+                unsigned verbose_level = 1) {
+            auto num_thrds = max(thread::hardware_concurrency(), 2u);
+            return this->operator()(speculative_policy(), layout, first_line, last_line, 
+                std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc), verbose_level, num_thrds);
+        }
+
+        // Generates the solution and writes it to layout, keeping the Markov
+        // chain of the sequential version. Annealing runs sequentially until 
+        // less than half of the moves of a temperature are accepted. From then
+        // on, each of num_thrds threads evaluates a move of its own on a copy
+        // of the current state at a time, as if the moves were drawn one after
+        // another. The first move accepted is committed, and the moves after
+        // it are dropped. The other threads replay it by its change record.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist, typename Alloc>
+            double operator()(speculative_policy, Layout<LayoutAlloc, Coord> &layout, 
+                FwdIt first_line, FwdIt last_line, ChgDist &&chg_dist, Alloc &&alloc,
+                unsigned verbose_level, unsigned num_thrds) {
+            using namespace std;
+            using change_record_t = typename generator_t::change_record_t;
+            if (layout.empty())
+                return 0;
+            if (num_thrds < 2)
+                return this->operator()(layout, first_line, last_line, 
+                    std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc),
+                    verbose_level);
+
+            size_t num_simulations = 0;
+            const auto start_time = chrono::steady_clock::now();
+            _first_feasible_time = chrono::steady_clock::duration::max();
+            _stats = statistics_t();
+            bool found_feasible = false;
+            auto note_feasible = [&](Coord w, Coord h) {
+                if (!found_feasible && _is_feasible(_energy_func, w, h)) {
+                    found_feasible = true;
+                    _first_feasible_time = chrono::steady_clock::now() - start_time;
+                }
+            };
+
+            // Deferred generator construction from layout.
+            _generator.construct(layout.widths(), layout.heights(), _eng); 
+            _track_moved_cells(_generator);
+            detail::BestStateTracker<generator_t> best;   // Layout is packed at last
+            best.reset(_generator);
+            auto res = _generator.make_resource();
+            
+            // Initial loop for determining starting temperature.
+            auto local_layout = layout;
+            double min_energy = numeric_limits<double>().max(), 
+                max_energy = numeric_limits<double>().min();
+            double curr_energy;
+            double sum_energies = 0, sum_sqrs = 0;   // For stddev
+            _reset_energy(_energy_func, local_layout, first_line, last_line);
+            
+            if (verbose_level) cout << "\n";
+            constexpr size_t init_sims = 64;  
+            for (size_t i = 0; i != init_sims; ++i) {
+                Coord w, h;
+                std::tie(w, h) = _generator(local_layout, _eng, res, chg_dist, alloc);
+                curr_energy = _evaluate(_energy_func, _generator, local_layout,
+                    first_line, last_line, w, h);
+                ++num_simulations;
+                note_feasible(w, h);
+                if (curr_energy < min_energy) {
+                    best.assign(_generator);
+                    min_energy = curr_energy;
+                }
+                sum_energies += curr_energy;
+                sum_sqrs += curr_energy * curr_energy;
+                max_energy = max(max_energy, curr_energy);
+                _generator.shuffle(_eng);
+            }
+            
+            auto stddev = sqrt((sum_sqrs - sum_energies * sum_energies / init_sims) / 
+                (init_sims - 1));
+            double temp = (stddev + numeric_limits<double>().epsilon()) / 
+                log(1.0 / _opts.initial_accepting_probability);
+
+            if (verbose_level) {
+                cout << "Starting temperature: " << temp << "\n";
+                cout << "Starting min energy: " << min_energy << "\n";
+                cout << "Starting max energy: " << max_energy << "\n";
+                cout << "Stddev: " << stddev << "\n";
+                if (verbose_level >= 2)
+                    cout << "\n";
+            }
+
+            // Main simulation process.
+            constexpr double temp_guard = 1.0, speculation_rate = 0.5;
+            const auto min_height = _min_height(layout);
+            size_t num_restarts = 0, num_early_rejections = 0, num_batches = 0;
+            size_t num_acceptions = 0, num_evaluated = 0;
+            bool need_restart = false;
+            sum_energies = 0;
+
+            // Closes a temperature. Returns whether to stop.
+            auto end_temperature = [&] {
+                _end_temperature(chg_dist);
+                const auto avg_energy = _average_energy(sum_energies, num_evaluated, 
+                    curr_energy);
+                if (verbose_level >= 2) {
+                    cout << "Temperature: " << temp << ", average energy: " << avg_energy <<
+                        ", acception rate: " << static_cast<double>(num_acceptions) /
+                        _opts.simulaions_per_temperature << "\n";
+                }
+                if (static_cast<double>(num_acceptions) < 
+                    _opts.stopping_accepting_probability * _opts.simulaions_per_temperature ||
+                    temp < temp_guard)
+                    return true;
+                need_restart = avg_energy > _opts.restart_ratio * min_energy;
+                if (need_restart) {
+                    best.restore(_generator);
+                    curr_energy = min_energy;
+                    ++num_restarts;
+                }
+                temp *= _opts.decreasing_ratio;
+                return false;
+            };
+
+            // Sequential stage
+            bool stop_simulation = false;
+            for (;;) {
+                num_acceptions = 0;
+                num_evaluated = 0;
+                sum_energies = 0;
+                for (size_t i = 0; i != _opts.simulaions_per_temperature; ++i) {
+                    auto max_energy = _draw_max_energy(curr_energy, temp, _eng);
+                    auto reject_width = _reject_width<Coord>(_energy_func, max_energy,
+                        min_height);
+                    Coord w, h;
+                    std::tie(w, h) = _generator(local_layout, _eng, res, chg_dist, alloc,
+                        reject_width);
+                    ++num_simulations;
+                    if (w >= reject_width) {
+                        ++num_early_rejections;
+                        _credit_change(chg_dist, _generator, false, 0);
+                        _checked_undo(std::forward<ChgDist>(chg_dist));
+                        continue;
+                    }
+                    auto new_energy = _evaluate(_energy_func, _generator, local_layout,
+                        first_line, last_line, w, h);
+                    sum_energies += new_energy;
+                    ++num_evaluated;
+
+                    _credit_change(chg_dist, _generator, new_energy < max_energy, 
+                        (curr_energy - new_energy) / temp);
+                    if (new_energy < max_energy) {
+                        note_feasible(w, h);
+                        best.push(_generator);
+                        if (new_energy < min_energy) {
+                            best.mark(_generator);
+                            min_energy = new_energy;
+                        }
+                        curr_energy = new_energy;
+                        ++num_acceptions;
+                    } else {
+                        _checked_undo(std::forward<ChgDist>(chg_dist));
+                        _undo_energy(_energy_func);
+                    }
+                }
+
+                stop_simulation = end_temperature();
+                if (stop_simulation)
+                    break;
+                if (need_restart) {
+                    _generator.pack(local_layout, _eng, res, alloc);
+                    _generator.reset_moved_cells();
+                    _reset_energy(_energy_func, local_layout, first_line, last_line);
+                }
+                if (num_acceptions < speculation_rate * _opts.simulaions_per_temperature)
+                    break;
+            }
+
+            // Speculative stage. Shared variables are written by the last 
+            // thread arriving at the barrier
+            constexpr auto no_winner = numeric_limits<size_t>::max();
+            vector<generator_t> thrd_generators;
+            vector<decay_t<ChgDist>> thrd_chg_dists(num_thrds, chg_dist);
+            vector<double> thrd_energies(num_thrds), thrd_max_energies(num_thrds);
+            vector<pair<Coord, Coord>> thrd_sizes(num_thrds);
+            vector<char> thrd_is_early(num_thrds);
+            size_t temp_simulations = 0, winner = no_winner;
+            change_record_t winner_change;
+
+            // Commits the first move accepted, and closes the temperature 
+            // when its moves are done
+            auto commit = [&] {
+                ++num_batches;
+                need_restart = false;
+                const auto num_moves = min<size_t>(num_thrds, 
+                    _opts.simulaions_per_temperature - temp_simulations);
+                winner = no_winner;
+                for (size_t k = 0; k != num_moves && winner == no_winner; ++k) {
+                    auto &gen = thrd_generators[k];
+                    ++num_simulations;
+                    ++temp_simulations;
+                    if (thrd_is_early[k]) {
+                        ++num_early_rejections;
+                        _credit_change(chg_dist, gen, false, 0);
+                        continue;
+                    }
+                    auto new_energy = thrd_energies[k];
+                    sum_energies += new_energy;
+                    ++num_evaluated;
+                    _credit_change(chg_dist, gen, new_energy < thrd_max_energies[k],
+                        (curr_energy - new_energy) / temp);
+                    if (new_energy < thrd_max_energies[k]) {
+                        winner = k;
+                        winner_change = gen.last_change();
+                        note_feasible(thrd_sizes[k].first, thrd_sizes[k].second);
+                        best.push(gen);
+                        if (new_energy < min_energy) {
+                            best.mark(gen);
+                            min_energy = new_energy;
+                        }
+                        curr_energy = new_energy;
+                        ++num_acceptions;
+                    }
+                }
+                if (temp_simulations == _opts.simulaions_per_temperature) {
+                    stop_simulation = end_temperature();
+                    for (auto &dist : thrd_chg_dists)
+                        dist = chg_dist;
+                    temp_simulations = 0;
+                    num_acceptions = 0;
+                    num_evaluated = 0;
+                    sum_energies = 0;
+                }
+            };
+
+            if (!stop_simulation) {
+                thrd_generators.assign(num_thrds, _generator);
+                detail::CyclicBarrier barrier(num_thrds);
+                vector<thread> thrds;
+                thrds.reserve(num_thrds);
+                for (auto i = num_thrds; i--; ) {
+                    thrds.emplace_back([&, i] {
+                        auto &my_gen = thrd_generators[i];
+                        auto &my_chg_dist = thrd_chg_dists[i];
+                        auto my_layout = local_layout;
+                        auto my_res = res;
+                        auto my_energy_func = _energy_func;
+                        boost::container::pmr::unsynchronized_pool_resource my_pool_resource;
+                        boost::container::pmr::polymorphic_allocator<char> my_alloc(
+                            std::addressof(my_pool_resource));  // Each thread allocates its memory
+                        random_engine_t my_eng(SEQPAIR_RANDOM_SEED());
+
+                        // Rebuilds the layout and the energy function of my_gen,
+                        // which is needed on restarts only
+                        auto resync = [&] {
+                            my_gen.pack(my_layout, my_eng, my_res, my_alloc);
+                            my_gen.reset_moved_cells();
+                            _reset_energy(my_energy_func, my_layout, first_line, last_line);
+                        };
+                        resync();
+
+                        for (;;) {
+                            // Evaluate a move of my own
+                            auto max_energy = _draw_max_energy(curr_energy, temp, my_eng);
+                            auto reject_width = _reject_width<Coord>(my_energy_func,
+                                max_energy, min_height);
+                            Coord w, h;
+                            std::tie(w, h) = my_gen(my_layout, my_eng, my_res, my_chg_dist,
+                                my_alloc, reject_width);
+                            thrd_max_energies[i] = max_energy;
+                            thrd_sizes[i] = make_pair(w, h);
+                            thrd_is_early[i] = w >= reject_width;
+                            if (!thrd_is_early[i])
+                                thrd_energies[i] = _evaluate(my_energy_func, my_gen, my_layout,
+                                    first_line, last_line, w, h);
+                            auto is_early = thrd_is_early[i];
+
+                            barrier.arrive_and_wait(commit);
+                            if (stop_simulation)
+                                break;
+                            if (need_restart) {
+                                detail::unguarded_copy_generator(_generator, my_gen);
+                                resync();
+                            } else if (winner != i) {
+                                _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                if (!is_early)
+                                    _undo_energy(my_energy_func);
+                                if (winner != no_winner) {
+                                    // Follow the winner, updating by moved cells
+                                    Coord w, h;
+                                    std::tie(w, h) = my_gen.redo(winner_change, my_layout, 
+                                        my_eng, my_res, my_alloc);
+                                    _evaluate(my_energy_func, my_gen, my_layout, 
+                                        first_line, last_line, w, h);
+                                }
+                            }
+                        }
+                    }); // Thread lambda
+                }
+                for (auto &&t : thrds)
+                    t.join();
+            }
+
+            // Output results
+            if (verbose_level) {
+                cout << "\n";
+                cout << "Finishing temperature: " << temp << "\n";
+                cout << "Finishing energy: " << curr_energy << "\n";
+                cout << "Total simulations: " << num_simulations << "\n";
+                cout << "Total early rejections: " << num_early_rejections << "\n";
+                cout << "Total restarts: " << num_restarts << "\n";
+                cout << "Total speculative batches: " << num_batches << "\n";
+                _print_first_feasible_time();
+                _print_change_distribution(chg_dist);
+            }
+            _stats.num_restarts = num_restarts;
+            _stats.num_batches = num_batches;
+            best.restore(_generator);
+            _generator.pack(layout, _eng, res, alloc);
+            return min_energy;
+        }
+
+        // Generates the solution by islands and writes it to layout.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist = generator_default_change_distribution,
+            typename Alloc = generator_allocator_type>
+            double operator()(island_policy, Layout<LayoutAlloc, Coord> &layout,
+                FwdIt first_line, FwdIt last_line,
+                ChgDist &&chg_dist = ChgDist(), Alloc &&alloc = Alloc(),
+                unsigned verbose_level = 1) {
+            auto num_thrds = max(thread::hardware_concurrency(), 2u);
+            return this->operator()(island_policy(), layout, first_line, last_line, 
+                std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc), verbose_level, num_thrds);
+        }
+
+        // Generates the solution by an island model and writes it to layout. 
+        // Each of num_thrds threads anneals a chain of its own with 
+        // simulaions_per_temperature moves per temperature, and stops and 
+        // restarts by itself. Islands form a ring: at the end of each 
+        // temperature an island posts its best state, if improved, to the 
+        // mailbox of the next one, and adopts the latest post in its own 
+        // mailbox if it is better than its current state. An island that has
+        // stopped relays better posts to the next one until all have stopped,
+        // so the ring stays connected. Mailboxes are lock-free, and there is
+        // no barrier.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt,
+            typename ChgDist, typename Alloc>
+            double operator()(island_policy, Layout<LayoutAlloc, Coord> &layout, 
+                FwdIt first_line, FwdIt last_line, ChgDist &&chg_dist, Alloc &&alloc,
+                unsigned verbose_level, unsigned num_thrds) {
+            using namespace std;
+            if (layout.empty())
+                return 0;
+            if (num_thrds < 2)
+                return this->operator()(layout, first_line, last_line, 
+                    std::forward<ChgDist>(chg_dist), std::forward<Alloc>(alloc),
+                    verbose_level);
+
+            const auto start_time = chrono::steady_clock::now();
+            _first_feasible_time = chrono::steady_clock::duration::max();
+            _stats = statistics_t();
+            atomic<bool> found_feasible{ false };
+            // Only the first thread finding one writes the time
+            auto note_feasible = [&](const energy_function_t &func, Coord w, Coord h) {
+                if (!found_feasible.load(memory_order_relaxed) && 
+                    _is_feasible(func, w, h) && !found_feasible.exchange(true))
+                    _first_feasible_time = chrono::steady_clock::now() - start_time;
+            };
+
+            // Deferred generator construction from layout.
+            _generator.construct(layout.widths(), layout.heights(), _eng);
+            _track_moved_cells(_generator);
+            auto res = _generator.make_resource();
+
+            // Initial loop for determining the starting temperature of islands.
+            auto main_layout = layout;
+            double sum_energies = 0, sum_sqrs = 0;   // For stddev
+            _reset_energy(_energy_func, main_layout, first_line, last_line);
+            constexpr size_t init_sims = 64;
+            for (size_t i = 0; i != init_sims; ++i) {
+                Coord w, h;
+                std::tie(w, h) = _generator(main_layout, _eng, res, chg_dist, alloc);
+                auto energy = _evaluate(_energy_func, _generator, main_layout,
+                    first_line, last_line, w, h);
+                note_feasible(_energy_func, w, h);
+                sum_energies += energy;
+                sum_sqrs += energy * energy;
+                _generator.shuffle(_eng);
+            }
+            auto stddev = sqrt((sum_sqrs - sum_energies * sum_energies / init_sims) /
+                (init_sims - 1));
+            const auto start_temp = (stddev + numeric_limits<double>().epsilon()) /
+                log(1.0 / _opts.initial_accepting_probability);
+            if (verbose_level) {
+                cout << "\n";
+                cout << "Starting temperature: " << start_temp << "\n";
+                cout << "Stddev: " << stddev << "\n";
+                if (verbose_level >= 2)
+                    cout << "\n";
+            }
+
+            struct post_t {
+                generator_t gen;
+                double energy;
+            };
+            const auto simulations_per_thrd = _opts.simulaions_per_temperature;
+            const auto min_height = _min_height(layout);
+            constexpr double temp_guard = 1.0;
+            vector<unique_ptr<detail::SingleSlotMailbox<post_t>>> mailboxes;
+            for (size_t i = 0; i != num_thrds; ++i)
+                mailboxes.push_back(make_unique<detail::SingleSlotMailbox<post_t>>(
+                    post_t{ _generator, 0 }));
+            vector<generator_t> thrd_generators(num_thrds, _generator);
+            vector<detail::BestStateTracker<generator_t>> thrd_bests(num_thrds);
+            vector<double> thrd_min_energies(num_thrds), thrd_finishing_temps(num_thrds);
+            vector<decay_t<ChgDist>> thrd_chg_dists(num_thrds, chg_dist);
+            atomic<size_t> num_simulations{ init_sims }, num_early_rejections{ 0 }, 
+                num_restarts{ 0 }, num_posts{ 0 }, num_adoptions{ 0 }, 
+                num_running_thrds{ num_thrds };
+            mutex cout_mutex;
+
+            vector<thread> thrds;
+            thrds.reserve(num_thrds);
+            for (auto i = num_thrds; i--; ) {
+                thrds.emplace_back([&, i] {
+                    auto &my_gen = thrd_generators[i];
+                    auto &my_best = thrd_bests[i];
+                    auto &my_chg_dist = thrd_chg_dists[i];
+                    auto &inbox = *mailboxes[i];
+                    auto &outbox = *mailboxes[(i + 1) % num_thrds];
+                    auto my_layout = main_layout;
+                    auto my_res = res;
+                    auto my_energy_func = _energy_func;
+                    boost::container::pmr::unsynchronized_pool_resource my_pool_resource;
+                    boost::container::pmr::polymorphic_allocator<char> my_alloc(
+                        std::addressof(my_pool_resource));  // Each thread allocates its memory
+                    random_engine_t my_eng(SEQPAIR_RANDOM_SEED());
+
+                    // Rebuilds the layout and the energy function of my_gen
+                    auto resync = [&] {
+                        Coord w, h;
+                        std::tie(w, h) = my_gen.pack(my_layout, my_eng, my_res, my_alloc);
+                        return _evaluate_from_scratch(my_energy_func, my_gen, my_layout,
+                            first_line, last_line, w, h);
+                    };
+
+                    // Each island starts from a state of its own
+                    my_gen.shuffle(my_eng);
+                    auto my_curr_energy = resync();
+                    auto my_min_energy = my_curr_energy, posted_energy = my_curr_energy;
+
+                    // Posts gen to the next island if it beats all posted before
+                    auto post_to_next = [&](const generator_t &gen, double energy) {
+                        if (energy >= posted_energy)
+                            return;
+                        auto &post = outbox.write_slot();
+                        detail::unguarded_copy_generator(gen, post.gen);
+                        post.energy = energy;
+                        outbox.post();
+                        posted_energy = energy;
+                        ++num_posts;
+                    };
+                    my_best.reset(my_gen);
+                    my_best.mark(my_gen);
+                    auto temp = start_temp;
+                    size_t my_num_simulations = 0, my_num_early_rejections = 0;
+
+                    for (;;) {
+                        size_t my_num_acceptions = 0, my_num_evaluated = 0;
+                        double my_sum_energies = 0;
+                        for (size_t j = 0; j != simulations_per_thrd; ++j) {
+                            auto max_energy = _draw_max_energy(my_curr_energy, temp, my_eng);
+                            auto reject_width = _reject_width<Coord>(my_energy_func,
+                                max_energy, min_height);
+                            Coord w, h;
+                            std::tie(w, h) = my_gen(my_layout, my_eng, my_res, my_chg_dist,
+                                my_alloc, reject_width);
+                            if (w >= reject_width) {
+                                ++my_num_early_rejections;
+                                _credit_change(my_chg_dist, my_gen, false, 0);
+                                _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                continue;
+                            }
+                            auto new_energy = _evaluate(my_energy_func, my_gen, my_layout,
+                                first_line, last_line, w, h);
+                            my_sum_energies += new_energy;
+                            ++my_num_evaluated;
+
+                            _credit_change(my_chg_dist, my_gen, new_energy < max_energy,
+                                (my_curr_energy - new_energy) / temp);
+                            if (new_energy < max_energy) {
+                                note_feasible(my_energy_func, w, h);
+                                my_best.push(my_gen);
+                                if (new_energy < my_min_energy) {
+                                    my_best.mark(my_gen);
+                                    my_min_energy = new_energy;
+                                }
+                                my_curr_energy = new_energy;
+                                ++my_num_acceptions;
+                            } else {
+                                _checked_undo(my_gen, std::forward<ChgDist>(my_chg_dist));
+                                _undo_energy(my_energy_func);
+                            }
+                        }
+                        my_num_simulations += simulations_per_thrd;
+                        _end_temperature(my_chg_dist);
+                        const auto my_avg_energy = _average_energy(my_sum_energies,
+                            my_num_evaluated, my_curr_energy);
+
+                        if (verbose_level >= 2) {
+                            lock_guard<mutex> lg(cout_mutex);
+                            cout << "Island " << i << ", temperature: " << temp << 
+                                ", average energy: " << my_avg_energy <<
+                                ", acception rate: " << static_cast<double>(my_num_acceptions) /
+                                simulations_per_thrd << "\n";
+                        }
+
+                        // Terminate criterion
+                        if (static_cast<double>(my_num_acceptions) <
+                            _opts.stopping_accepting_probability * simulations_per_thrd ||
+                            temp < temp_guard)
+                            break;
+
+                        // Post my best to the next island
+                        post_to_next(my_best.best(), my_min_energy);
+
+                        // Adopt the post from the previous island, or restart if necessary
+                        if (inbox.take() && inbox.read_slot().energy < my_curr_energy) {
+                            detail::unguarded_copy_generator(inbox.read_slot().gen, my_gen);
+                            my_curr_energy = resync();
+                            my_best.detach();
+                            if (my_curr_energy < my_min_energy) {
+                                my_best.mark(my_gen);
+                                my_min_energy = my_curr_energy;
+                            }
+                            ++num_adoptions;
+                        } else if (my_avg_energy > _opts.restart_ratio * my_min_energy) {
+                            my_best.restore(my_gen);
+                            my_curr_energy = resync();
+                            ++num_restarts;
+                        }
+
+                        // Drop temperature
+                        temp *= _opts.decreasing_ratio;
+                    }
+
+                    // Keep the ring connected for the islands still running
+                    post_to_next(my_best.best(), my_min_energy);
+                    --num_running_thrds;
+                    while (num_running_thrds.load()) {
+                        if (inbox.take())
+                            post_to_next(inbox.read_slot().gen, inbox.read_slot().energy);
+                        else
+                            this_thread::yield();
+                    }
+
+                    thrd_min_energies[i] = my_min_energy;
+                    thrd_finishing_temps[i] = temp;
+                    num_simulations += my_num_simulations;
+                    num_early_rejections += my_num_early_rejections;
+                }); // Thread lambda
+            }
+            for (auto &&t : thrds)
+                t.join();
+
+            // Best of the islands
+            auto best_thrd = min_element(thrd_min_energies.cbegin(), thrd_min_energies.cend()) -
+                thrd_min_energies.cbegin();
+            if (verbose_level) {
+                cout << "\n";
+                cout << "Finishing temperatures: " << *min_element(thrd_finishing_temps.cbegin(),
+                    thrd_finishing_temps.cend()) << " to " << *max_element(
+                    thrd_finishing_temps.cbegin(), thrd_finishing_temps.cend()) << "\n";
+                cout << "Total simulations: " << num_simulations << "\n";
+                cout << "Total early rejections: " << num_early_rejections << "\n";
+                cout << "Total restarts: " << num_restarts << "\n";
+                cout << "Total adoptions: " << num_adoptions << " of " << num_posts << "\n";
+                _print_first_feasible_time();
+            }
+            _stats.num_restarts = num_restarts;
+            _stats.num_posts = num_posts;
+            _stats.num_adoptions = num_adoptions;
+            _merge_change_distributions(chg_dist, thrd_chg_dists);
+            if (verbose_level)
+                _print_change_distribution(chg_dist);
+            thrd_bests[best_thrd].restore(_generator);
+            _generator.pack(layout, _eng, res, alloc);
+            return thrd_min_energies[best_thrd];
+        }
+
+    protected: 
+        // Checks option.
+        bool _is_option_valid(const options_t &opts) const noexcept {
+            return opts.initial_accepting_probability > 0 &&
+                opts.initial_accepting_probability < 1 &&
+                opts.simulaions_per_temperature &&
+                opts.decreasing_ratio > 0 &&
+                opts.decreasing_ratio < 1 &&
+                opts.restart_ratio > 1 &&
+                opts.stopping_accepting_probability > 0 &&
+                opts.stopping_accepting_probability <= 1;
+        }
+
+        // Throws on invalid option.
+        const options_t &_checked_option(const options_t &opts) const {
+            if (!_is_option_valid(opts))
+                throw std::invalid_argument("Invalid argument");
+            return opts;
+        }
+
+        // Invokes generator_t::rollback and checks the return value.
+        template<typename ChgDist>
+        bool _checked_undo(ChgDist &&chg_dist) {
+            return _checked_undo(_generator, chg_dist);
+        }
+
+        // Invokes generator_t::rollback and checks the return value.
+        template<typename ChgDist>
+        bool _checked_undo(generator_t &gen, ChgDist &&chg_dist) const {
+            auto b = gen.rollback();
+            assert(detail::may_change_be_none(std::forward<ChgDist>(chg_dist)) || b);
+            return b;
+        }
+
+        using is_stateful_energy_function = IsStatefulEnergyFunction<energy_function_t>;
+
+        // Lets gen report moved cells if the energy function uses them.
+        void _track_moved_cells(generator_t &gen) const {
+            if (is_stateful_energy_function::value)
+                gen.set_tracks_moved_cells(true);
+        }
+
+        // Evaluates the layout just generated by gen.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static double _evaluate(energy_function_t &func, const generator_t &gen,
+            const Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line,
+            Coord w, Coord h) {
+            return _evaluate(func, gen, layout, first_line, last_line, w, h,
+                is_stateful_energy_function());
+        }
+
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static double _evaluate(energy_function_t &func, const generator_t &,
+            const Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line,
+            Coord w, Coord h, std::false_type) {
+            return func(layout, first_line, last_line, w, h);
+        }
+
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static double _evaluate(energy_function_t &func, const generator_t &gen,
+            const Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line,
+            Coord w, Coord h, std::true_type) {
+            const auto &cells = gen.moved_cells();
+            return func(layout, first_line, last_line, w, h, cells.cbegin(), cells.cend());
+        }
+
+        // Evaluates layout just packed by gen from scratch, and rebuilds the
+        // state of the energy function from it.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static double _evaluate_from_scratch(energy_function_t &func, generator_t &gen,
+            const Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line,
+            Coord w, Coord h) {
+            gen.reset_moved_cells();
+            _reset_energy(func, layout, first_line, last_line);
+            return _evaluate(func, gen, layout, first_line, last_line, w, h);
+        }
+
+        // Rebuilds the state of the energy function from layout.
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static void _reset_energy(energy_function_t &func, 
+            const Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line) {
+            _reset_energy(func, layout, first_line, last_line, is_stateful_energy_function());
+        }
+
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static void _reset_energy(energy_function_t &, const Layout<LayoutAlloc, Coord> &,
+            FwdIt, FwdIt, std::false_type) { }
+
+        template<typename LayoutAlloc, typename Coord, typename FwdIt>
+        static void _reset_energy(energy_function_t &func, 
+            const Layout<LayoutAlloc, Coord> &layout, FwdIt first_line, FwdIt last_line,
+            std::true_type) {
+            func.reset(layout, first_line, last_line);
+        }
+
+        // Draws the Metropolis threshold before evaluation: a move of energy
+        // e is accepted iff e < curr_energy - temp * log(u) for uniform u.
+        // -log(u) is drawn from the exponential ziggurat, so that it takes 
+        // no logarithm in most cases with a 64-bit engine.
+        template<typename OtherEng>
+        static double _draw_max_energy(double curr_energy, double temp, OtherEng &&eng) {
+            return curr_energy + temp * detail::exponential_random(eng);
+        }
+
+        // Average energy of the num_evaluated moves of a temperature that are
+        // evaluated in full. Moves rejected early have no energy and are left
+        // out; if all of them are, the chain stays at curr_energy.
+        static double _average_energy(double sum_energies, std::size_t num_evaluated,
+            double curr_energy) noexcept {
+            return num_evaluated ? sum_energies / num_evaluated : curr_energy;
+        }
+
+        // Width from which a move is rejected given max_energy, which the
+        // generator may stop at. Rounded up to stay conservative.
+        template<typename Coord>
+        static Coord _reject_width(const energy_function_t &func, double max_energy,
+            double min_height) {
+            return _reject_width<Coord>(func, max_energy, min_height,
+                IsWidthBoundedEnergyFunction<energy_function_t>());
+        }
+
+        template<typename Coord>
+        static Coord _reject_width(const energy_function_t &, double, double, 
+            std::false_type) {
+            return std::numeric_limits<Coord>::max();
+        }
+
+        template<typename Coord>
+        static Coord _reject_width(const energy_function_t &func, double max_energy,
+            double min_height, std::true_type) {
+            using limits = std::numeric_limits<Coord>;
+            auto width = func.reject_width(max_energy, min_height);
+            width = std::ceil(width + std::abs(width) * 1e-12);
+            if (!(width < static_cast<double>(limits::max())))
+                return limits::max();
+            return static_cast<Coord>(std::max(width, 0.0));
+        }
+
+        // Height no packing of layout can be below: the longest of the 
+        // shorter sides of components.
+        template<typename LayoutAlloc, typename Coord>
+        static double _min_height(const Layout<LayoutAlloc, Coord> &layout) {
+            Coord ans = 0;
+            for (std::size_t i = 0; i != layout.size(); ++i)
+                ans = std::max(ans, std::min(layout.widths()[i], layout.heights()[i]));
+            return static_cast<double>(ans);
+        }
+
+        // Whether a packing of w x h meets the constraints of func.
+        template<typename Coord>
+        static bool _is_feasible(const energy_function_t &func, Coord w, Coord h) {
+            return _is_feasible(func, w, h, IsConstrainedEnergyFunction<energy_function_t>());
+        }
+
+        template<typename Coord>
+        static bool _is_feasible(const energy_function_t &, Coord, Coord, std::false_type) {
+            return true;
+        }
+
+        template<typename Coord>
+        static bool _is_feasible(const energy_function_t &func, Coord w, Coord h, 
+            std::true_type) {
+            return func.is_feasible(w, h);
+        }
+
+        // Offers the best state to the migration every interval temperatures.
+        // Returns: whether incoming holds a better state than curr_energy
+        template<typename LayoutAlloc, typename Coord>
+        bool _migrate(const Layout<LayoutAlloc, Coord> &layout, 
+            detail::BestStateTracker<generator_t> &best, double min_energy,
+            double curr_energy, std::size_t num_temperatures,
+            typename migration_t::snapshot_t &outgoing, 
+            typename migration_t::snapshot_t &incoming) {
+            if (!_migration.exchange || num_temperatures % _migration.interval)
+                return false;
+            best.best().save(outgoing, layout.widths());
+            double incoming_energy;
+            return _migration.exchange(outgoing, min_energy, incoming, incoming_energy) &&
+                incoming_energy < curr_energy;
+        }
+
+        // Publishes progress after a temperature, if any.
+        // Returns: whether the run is cancelled
+        bool _publish_progress(double min_energy) noexcept {
+            if (!_progress)
+                return false;
+            _progress->min_energy.store(min_energy, std::memory_order_relaxed);
+            _progress->num_temperatures.fetch_add(1, std::memory_order_relaxed);
+            return _progress->cancelled.load(std::memory_order_relaxed);
+        }
+
+        // Prints first_feasible_time() for constrained energy functions.
+        void _print_first_feasible_time() const {
+            using namespace std;
+            if (!IsConstrainedEnergyFunction<energy_function_t>::value)
+                return;
+            cout << "Time to first feasible: ";
+            if (_first_feasible_time == chrono::steady_clock::duration::max())
+                cout << "none" << "\n";
+            else
+                cout << chrono::duration_cast<chrono::milliseconds>(
+                    _first_feasible_time).count() << "ms" << "\n";
+        }
+
+        // Credits the last move of gen to an adaptive chg_dist, where gain is 
+        // the energy decrease relative to temperature.
+        template<typename ChgDist>
+        static void _credit_change(ChgDist &chg_dist, const generator_t &gen, bool accepted,
+            double gain) {
+            _credit_change(chg_dist, gen, accepted, gain, 
+                detail::IsAdaptiveChangeDistribution<ChgDist>());
+        }
+
+        template<typename ChgDist>
+        static void _credit_change(ChgDist &, const generator_t &, bool, double, 
+            std::false_type) { }
+
+        template<typename ChgDist>
+        static void _credit_change(ChgDist &chg_dist, const generator_t &gen, bool accepted,
+            double gain, std::true_type) {
+            chg_dist.update(std::get<0>(gen.last_change()), accepted, std::max(gain, 0.0));
+        }
+
+        // Lets an adaptive chg_dist reweight changes.
+        template<typename ChgDist>
+        static void _end_temperature(ChgDist &chg_dist) {
+            _end_temperature(chg_dist, detail::IsAdaptiveChangeDistribution<ChgDist>());
+        }
+
+        template<typename ChgDist>
+        static void _end_temperature(ChgDist &, std::false_type) { }
+
+        template<typename ChgDist>
+        static void _end_temperature(ChgDist &chg_dist, std::true_type) {
+            chg_dist.end_temperature();
+        }
+
+        // Sets an adaptive chg_dist to the average of the thread-local ones.
+        template<typename ChgDist, typename Cont>
+        static void _merge_change_distributions(ChgDist &chg_dist, const Cont &thrd_chg_dists) {
+            _merge_change_distributions(chg_dist, thrd_chg_dists, 
+                detail::IsAdaptiveChangeDistribution<ChgDist>());
+        }
+
+        template<typename ChgDist, typename Cont>
+        static void _merge_change_distributions(ChgDist &, const Cont &, std::false_type) { }
+
+        template<typename ChgDist, typename Cont>
+        static void _merge_change_distributions(ChgDist &chg_dist, const Cont &thrd_chg_dists,
+            std::true_type) {
+            auto probs = chg_dist.probabilities();
+            probs.fill(0.0);
+            for (const auto &dist : thrd_chg_dists) {
+                auto p = dist.probabilities();
+                for (std::size_t k = 0; k != probs.size(); ++k)
+                    probs[k] += p[k] / thrd_chg_dists.size();
+            }
+            chg_dist.assign(probs.cbegin(), probs.cend());
+        }
+
+        // Prints the learned probabilities of an adaptive chg_dist.
+        template<typename ChgDist>
+        static void _print_change_distribution(const ChgDist &chg_dist) {
+            _print_change_distribution(chg_dist, detail::IsAdaptiveChangeDistribution<ChgDist>());
+        }
+
+        template<typename ChgDist>
+        static void _print_change_distribution(const ChgDist &, std::false_type) { }
+
+        template<typename ChgDist>
+        static void _print_change_distribution(const ChgDist &chg_dist, std::true_type) {
+            using namespace std;
+            using change_t = typename generator_t::change_t;
+            auto probs = chg_dist.probabilities();
+            cout << "Change probabilities:";
+            for (size_t k = 0; k != probs.size(); ++k)
+                if (probs[k] > 1e-9)
+                    cout << " " << generator_t::change_name(static_cast<change_t>(k)) <<
+                        " " << probs[k];
+            cout << "\n";
+        }
+
+        // Restores the state of the energy function after rejecting a move.
+        static void _undo_energy(energy_function_t &func) {
+            _undo_energy(func, is_stateful_energy_function());
+        }
+
+        static void _undo_energy(energy_function_t &, std::false_type) { }
+
+        static void _undo_energy(energy_function_t &func, std::true_type) {
+            func.rollback();
+        }
+
+        // Note: actually _energy_func had better be stored in boost::compressed_pair
+        options_t _opts;
+        energy_function_t _energy_func; 
+        random_engine_t _eng;
+        generator_t _generator;
+        std::chrono::steady_clock::duration _first_feasible_time = 
+            std::chrono::steady_clock::duration::max();
+        statistics_t _stats;
+        progress_t *_progress = nullptr;
+        migration_t _migration;
+    };
+
+    // Helper function for constructing SaPacker.
+    template<typename Generator, typename EFunc =
+        typename SaPackerBase::default_energy_function, typename... Types>
+        SaPacker<Generator, std::decay_t<EFunc>>
+        makeSaPacker(const typename SaPackerBase::options_t &opts =
             typename SaPackerBase::options_t(), EFunc &&func = EFunc(),
             Types &&...args) {
         return SaPacker<Generator, std::decay_t<EFunc>>(opts,
             std::forward<EFunc>(func), std::forward<Types>(args)...);
     }
+
+    // Helper function for constructing SaPacker with random engine Eng.
+    template<typename Generator, typename Eng, typename EFunc =
+        typename SaPackerBase::default_energy_function, typename... Types>
+        SaPacker<Generator, std::decay_t<EFunc>, Eng>
+        makeSaPackerWithEngine(const typename SaPackerBase::options_t &opts =
+            typename SaPackerBase::options_t(), EFunc &&func = EFunc(),
+            Types &&...args) {
+        return SaPacker<Generator, std::decay_t<EFunc>, Eng>(opts,
+            std::forward<EFunc>(func), std::forward<Types>(args)...);
+    }
 }
@@ -6,6 +6,11 @@
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 #include "layout.h"
 
 namespace rect_packing {
@@ -31,6 +36,52 @@ namespace rect_packing {
                     width - k, height, std::forward<Eng>(eng));
                 return cnt0 + cnt1;
             }
+
+            // Sweeps components [first, last) of layout along x, keeping the
+            // y-intervals crossing the sweep line in a set. They are disjoint
+            // until an overlap is found, so their upper ends ascend with the 
+            // lower ends, and only the last interval starting below a new one
+            // can overlap it. O(n log n).
+            template<typename Alloc, typename Coord, typename FwdIt>
+            bool sweep_intersection(const Layout<Alloc, Coord> &layout, FwdIt first, 
+                FwdIt last, std::pair<std::size_t, std::size_t> &which) {
+                using namespace std;
+                const auto &x = layout.x(), &y = layout.y();
+                const auto &w = layout.widths(), &h = layout.heights();
+                // Leaving before zero-width checks before entering at the same x
+                enum event_t { leave, check, enter };
+                vector<tuple<Coord, event_t, size_t>> events;
+                for (auto i = first; i != last; ++i) {
+                    size_t k = *i;
+                    if (w[k] == 0) {
+                        events.emplace_back(x[k], check, k);
+                    } else {
+                        events.emplace_back(x[k], enter, k);
+                        events.emplace_back(x[k] + w[k], leave, k);
+                    }
+                }
+                sort(events.begin(), events.end());
+
+                set<tuple<Coord, Coord, size_t>> active;   // y-intervals
+                for (const auto &e : events) {
+                    auto k = get<2>(e);
+                    auto lo = y[k], hi = y[k] + h[k];
+                    if (get<1>(e) == leave) {
+                        active.erase(make_tuple(lo, hi, k));
+                        continue;
+                    }
+                    // Last interval [lo', hi') with lo' < hi overlaps iff lo < hi'
+                    auto it = active.lower_bound(make_tuple(hi, numeric_limits<Coord>::min(),
+                        size_t(0)));
+                    if (it != active.begin() && lo < get<1>(*--it)) {
+                        which = minmax(get<2>(*it), k);
+                        return true;
+                    }
+                    if (get<1>(e) == enter)
+                        active.emplace(lo, hi, k);
+                }
+                return false;
+            }
         }   // detail
 
         // Constructs a layout which in optimial can be exactly packed into a rectangle 
@@ -55,14 +106,84 @@ namespace rect_packing {
             return layout;
         }
 
+        // Finds a pair of overlapping components by sweep line in O(n log n),
+        // and writes it to which. Components overlap iff their interiors 
+        // intersect, which holds for a zero-area one inside another as well.
+        // Compares in Coord, since Rect holds int only.
+        template<typename Alloc, typename Coord>
+        bool find_intersection(const Layout<Alloc, Coord> &layout, 
+            std::pair<std::size_t, std::size_t> &which) {
+            std::vector<std::size_t> all(layout.size());
+            std::iota(all.begin(), all.end(), std::size_t(0));
+            return detail::sweep_intersection(layout, all.cbegin(), all.cend(), which);
+        }
+
+        // As above, which splits the plane into num_thrds x-slabs of about
+        // equal components and sweeps them in parallel. A component is swept 
+        // in each slab it enters, so that any overlap is found in the slab 
+        // holding a point of it. Reports the overlap of the leftmost slab.
+        template<typename Alloc, typename Coord>
+        bool find_intersection(const Layout<Alloc, Coord> &layout, 
+            std::pair<std::size_t, std::size_t> &which, unsigned num_thrds) {
+            using namespace std;
+            const auto sz = layout.size();
+            num_thrds = static_cast<unsigned>(min<size_t>(num_thrds, sz / 1024));
+            if (num_thrds < 2)
+                return find_intersection(layout, which);
+
+            // Slab boundaries at quantiles of left ends
+            const auto &x = layout.x(), &w = layout.widths();
+            vector<Coord> lefts(x.cbegin(), x.cend());
+            sort(lefts.begin(), lefts.end());
+            vector<Coord> bounds;   // Slab k is [bounds[k], bounds[k + 1])
+            bounds.push_back(numeric_limits<Coord>::min());
+            for (unsigned k = 1; k != num_thrds; ++k)
+                if (lefts[k * sz / num_thrds] > bounds.back())
+                    bounds.push_back(lefts[k * sz / num_thrds]);
+            bounds.push_back(numeric_limits<Coord>::max());
+            const auto num_slabs = bounds.size() - 1;
+
+            vector<vector<size_t>> slabs(num_slabs);
+            for (size_t i = 0; i != sz; ++i) {
+                auto lo = x[i], hi = x[i] + w[i];
+                auto k = static_cast<size_t>(
+                    upper_bound(bounds.cbegin(), bounds.cend(), lo) - bounds.cbegin() - 1);
+                do {
+                    slabs[k].push_back(i);
+                } while (++k != num_slabs && bounds[k] < hi);
+            }
+
+            vector<pair<size_t, size_t>> found(num_slabs);
+            vector<char> has_found(num_slabs, false);
+            vector<thread> thrds;
+            thrds.reserve(num_slabs);
+            for (size_t k = 0; k != num_slabs; ++k)
+                thrds.emplace_back([&, k] {
+                    has_found[k] = detail::sweep_intersection(layout, 
+                        slabs[k].cbegin(), slabs[k].cend(), found[k]);
+                });
+            for (auto &t : thrds)
+                t.join();
+            auto it = find(has_found.cbegin(), has_found.cend(), true);
+            if (it == has_found.cend())
+                return false;
+            which = found[it - has_found.cbegin()];
+            return true;
+        }
+
         // Checks for overlap.
-        template<typename Alloc>
-        bool has_intersection(const Layout<Alloc> &layout) noexcept {
-            for (size_t i = 0; i != layout.size(); ++i)
-                for (size_t j = i + 1; j != layout.size(); ++j)
-                    if (intersects(layout.rect(i), layout.rect(j)))
-                        return true;
-            return false;
+        template<typename Alloc, typename Coord>
+        bool has_intersection(const Layout<Alloc, Coord> &layout) {
+            std::pair<std::size_t, std::size_t> which;
+            return find_intersection(layout, which);
+        }
+
+        // Checks whether cost is a recomputed one (e.g. packing_cost of layout)
+        // up to rounding.
+        inline bool is_cost_consistent(double cost, double recomputed) noexcept {
+            using namespace std;
+            return abs(cost - recomputed) <= 
+                16 * numeric_limits<double>::epsilon() * max(1.0, abs(recomputed));
         }
 
         // Tries to scatter [0, n) to count pairs, and writes them to dest.